@@ -3,8 +3,10 @@
 #include "PhysXMaterial.h"
 #include "StaticBody.h"
 #include "DynamicBody.h"
+#include "PhysXScene.h"
 #include <Urho3D/Core/Context.h>
 #include <Urho3D/Scene/Node.h>
+#include <Urho3D/Scene/Scene.h>
 #include <Urho3D/Resource/ResourceCache.h>
 #include <Urho3D/Graphics/Model.h>
 #include <Urho3D/Graphics/StaticModel.h>
@@ -27,23 +29,42 @@ namespace Urho3DPhysX
         //heightfield,
         nullptr
     };
+
+    ///PhysX geometry type of each PhysXShapeType, geometry can be changed in place only if type is the same
+    static const PxGeometryType::Enum shapeGeometryTypes[] =
+    {
+        PxGeometryType::eBOX,
+        PxGeometryType::eSPHERE,
+        PxGeometryType::ePLANE,
+        PxGeometryType::eCAPSULE,
+        PxGeometryType::eCONVEXMESH,
+        PxGeometryType::eTRIANGLEMESH
+    };
 }
 
 Urho3DPhysX::CollisionShape::CollisionShape(Context * context) : Component(context),
+shape_(nullptr),
 rigidActor_(nullptr),
 position_(Vector3::ZERO),
 rotation_(Quaternion::IDENTITY),
 planeNormal_(Vector3::UP),
 size_(Vector3::ONE),
 cachedWorldScale_(Vector3::ONE),
-shape_(nullptr),
 shapeType_(BOX_SHAPE),
+material_(nullptr),
 trigger_(false),
 collisionLayer_(DEF_COLLISION_LAYER),
 collisionMask_(DEF_COLLISION_MASK),
+contactReportFlags_(CR_DEFAULT),
 customModel_(nullptr),
 modelLodLevel_(0),
-material_(nullptr)
+asyncCooking_(false),
+cookingFlags_(MC_DEFAULT),
+meshPending_(false),
+geometryDirty_(false),
+shapeQueued_(false),
+shared_(false),
+sharedShape_(false)
 {    
 }
 
@@ -54,6 +75,8 @@ Urho3DPhysX::CollisionShape::~CollisionShape()
 
 void Urho3DPhysX::CollisionShape::ApplyAttributes()
 {
+    //all attributes are loaded, build geometry once
+    ApplyShapeChanges();
 }
 
 void Urho3DPhysX::CollisionShape::RegisterObject(Context * context)
@@ -67,9 +90,13 @@ void Urho3DPhysX::CollisionShape::RegisterObject(Context * context)
     URHO3D_ACCESSOR_ATTRIBUTE("Trigger", IsTrigger, SetTrigger, bool, false, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Collision layer", GetCollisionLayer, SetCollisionLayer, unsigned, DEF_COLLISION_LAYER, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Collision mask", GetCollisionMask, SetCollisionMask, unsigned, DEF_COLLISION_MASK, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Contact report flags", GetContactReportFlags, SetContactReportFlags, unsigned, CR_DEFAULT, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Material", GetMaterialAttr, SetMaterialAttr, ResourceRef, ResourceRef(PhysXMaterial::GetTypeStatic()), AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Custom model", GetCustomModelAttr, SetCustomModelAttr, ResourceRef, ResourceRef(Model::GetTypeStatic()), AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Model LOD level", GetModelLODLevel, SetModelLODLevel, unsigned, 0, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Async cooking", IsAsyncCooking, SetAsyncCooking, bool, false, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Cooking flags", GetCookingFlags, SetCookingFlags, unsigned, MC_DEFAULT, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Shared shape", IsShared, SetShared, bool, false, AM_DEFAULT);
 }
 
 void Urho3DPhysX::CollisionShape::DrawDebugGeometry(DebugRenderer * debug, bool depthTest)
@@ -168,7 +195,7 @@ void Urho3DPhysX::CollisionShape::OnNodeSet(Node * node)
     if (node)
     {
         node->AddListener(this);
-        UpdateShape();
+        MarkShapeDirty();
     }
 }
 
@@ -176,6 +203,11 @@ void Urho3DPhysX::CollisionShape::OnSetEnabled()
 {
     if (shape_)
     {
+        if (sharedShape_)
+        {
+            MarkShapeDirty();
+            return;
+        }
         if (trigger_)
         {
             shape_->setFlag(PxShapeFlag::eSIMULATION_SHAPE, false);
@@ -188,7 +220,7 @@ void Urho3DPhysX::CollisionShape::OnSetEnabled()
             {
                 RigidBody* rigidBody = rigidActor_->Cast<RigidBody>();
                 if (rigidBody)
-                    rigidBody->UpdateMassAndInertia();
+                    rigidBody->MarkDirty();
             }
         }
     }
@@ -197,6 +229,8 @@ void Urho3DPhysX::CollisionShape::OnSetEnabled()
 void Urho3DPhysX::CollisionShape::UpdateShape()
 {
     ReleaseShape();
+    meshPending_ = false;
+    geometryDirty_ = false;
     if (node_)
     {
         auto* physics = GetSubsystem<Physics>();
@@ -214,35 +248,13 @@ void Urho3DPhysX::CollisionShape::UpdateShape()
         PxMaterial* mat = material_->GetMaterial();
         if (node_)
         {
-            cachedWorldScale_ = node_->GetWorldScale();
-            switch (shapeType_)
+            PxGeometryHolder geometry;
+            if (CreateGeometry(geometry))
             {
-            case Urho3DPhysX::BOX_SHAPE:
-                shape_ = px->createShape(PxBoxGeometry(ToPxVec3(size_ * cachedWorldScale_ * 0.5f)), *mat, true);
-                break;
-            case Urho3DPhysX::SPHERE_SHAPE:
-                shape_ = px->createShape(PxSphereGeometry(size_.x_ * cachedWorldScale_.x_ * 0.5f), *mat, true);
-                break;
-            case Urho3DPhysX::PLANE_SHAPE:
-                shape_ = px->createShape(PxPlaneGeometry(), *mat, true);
-                break;
-            case Urho3DPhysX::CAPSULE_SHAPE:
-                shape_ = px->createShape(PxCapsuleGeometry(size_.x_ * cachedWorldScale_.x_ * 0.5f, size_.y_ * cachedWorldScale_.y_ * 0.5f), *mat, true);
-                break;
-            case Urho3DPhysX::CONVEXMESH_SHAPE:
-                if (!CreateConvexMesh())
-                {
-                    //TODO: handle this
-                }
-                break;
-            case Urho3DPhysX::TRIANGLEMESH_SHAPE:
-                if (!CreateTriangleMesh())
-                {
-                    //TODO: handle this
-                }
-                break;
-            default:
-                break;
+                if (CanShareShape())
+                    AcquireSharedShape(geometry);
+                if (!shape_)
+                    shape_ = px->createShape(geometry.any(), *mat, true, GetShapeFlags());
             }
             //check if shape creation failed
             if (!shape_)
@@ -251,18 +263,13 @@ void Urho3DPhysX::CollisionShape::UpdateShape()
             }
             else
             {
-                PxFilterData filter;
-                filter.word0 = collisionLayer_;
-                filter.word1 = collisionMask_;
-                shape_->setSimulationFilterData(filter);
-                shape_->setQueryFilterData(filter);
-                SetMaterial(material_);
-                UpdateShapePose();
-                shape_->userData = this;
-                if (trigger_)
+                //pooled shape is already set up, only exclusive shape is configured here
+                if (!sharedShape_)
                 {
-                    shape_->setFlag(PxShapeFlag::eSIMULATION_SHAPE, false);
-                    shape_->setFlag(PxShapeFlag::eTRIGGER_SHAPE, true);
+                    UpdateFilterData();
+                    SetMaterial(material_);
+                    UpdateShapePose();
+                    shape_->userData = this;
                 }
                 RigidActor* actor = node_->GetDerivedComponent<RigidActor>();
                 if (actor)
@@ -272,23 +279,188 @@ void Urho3DPhysX::CollisionShape::UpdateShape()
     }
 }
 
-void Urho3DPhysX::CollisionShape::UpdateShapePose()
+void Urho3DPhysX::CollisionShape::ApplyShapeChanges()
 {
-    if (shape_)
+    if (!geometryDirty_)
+        return;
+    geometryDirty_ = false;
+    if (!node_)
+        return;
+    //same geometry type is changed in place, shape stays attached and keeps its flags, filter data and material.
+    //shared shapes can't be modified, they are always exchanged for other one from the pool
+    if (shape_ && !sharedShape_ && !CanShareShape() && shape_->getGeometryType() == shapeGeometryTypes[shapeType_])
     {
-        if (shapeType_ == PLANE_SHAPE)
+        PxGeometryHolder geometry;
+        if (CreateGeometry(geometry))
         {
-            shape_->setLocalPose(PxTransformFromPlaneEquation(PxPlane(ToPxVec3(position_), ToPxVec3(planeNormal_))));
+            shape_->setGeometry(geometry.any());
+            //pose of plane depends on shape type, mass is updated here too
+            UpdateShapePose();
         }
         else
         {
-            shape_->setLocalPose(PxTransform(ToPxVec3(position_), ToPxQuat(rotation_)));
+            //mesh failed or is cooked in background, shape stays detached as if it was recreated
+            ReleaseShape();
+        }
+        return;
+    }
+    UpdateShape();
+}
+
+void Urho3DPhysX::CollisionShape::MarkShapeDirty()
+{
+    geometryDirty_ = true;
+    Scene* scene = GetScene();
+    if (scene)
+    {
+        if (!shapeQueued_)
+        {
+            shapeQueued_ = true;
+            scene->GetOrCreateComponent<PhysXScene>()->MarkShapeDirty(this);
+        }
+    }
+    else
+        ApplyShapeChanges();
+}
+
+void Urho3DPhysX::CollisionShape::SetShared(bool enable)
+{
+    if (shared_ != enable)
+    {
+        shared_ = enable;
+        if (node_)
+            MarkShapeDirty();
+    }
+}
+
+bool Urho3DPhysX::CollisionShape::CanShareShape() const
+{
+    if (!shared_)
+        return false;
+    //simulation flag of triangle mesh and plane is modified when attached to non-kinematic body
+    if ((shapeType_ == TRIANGLEMESH_SHAPE || shapeType_ == PLANE_SHAPE) && node_ && node_->GetDerivedComponent<RigidBody>())
+        return false;
+    return true;
+}
+
+void Urho3DPhysX::CollisionShape::AcquireSharedShape(const PxGeometryHolder & geometry)
+{
+    auto* physics = GetSubsystem<Physics>();
+    PxFilterData simulationFilter;
+    PxFilterData queryFilter;
+    GetFilterData(simulationFilter, queryFilter);
+    PxShape* shape = physics->AcquireSharedShape(geometry, material_->GetMaterial(), GetLocalPose(), simulationFilter, queryFilter, GetShapeFlags());
+    if (!shape)
+        return;
+    //identical shapes on one node would attach the same PxShape twice, use exclusive shape then
+    RigidActor* actor = node_->GetDerivedComponent<RigidActor>();
+    PxRigidActor* pxActor = actor ? actor->GetActor() : nullptr;
+    if (pxActor && pxActor->getNbShapes())
+    {
+        PODVector<PxShape*> attachedShapes(pxActor->getNbShapes());
+        pxActor->getShapes(&attachedShapes[0], attachedShapes.Size());
+        if (attachedShapes.Contains(shape))
+        {
+            physics->ReleaseSharedShape(shape);
+            return;
+        }
+    }
+    shape_ = shape;
+    sharedShape_ = true;
+}
+
+void Urho3DPhysX::CollisionShape::GetFilterData(PxFilterData & simulationFilter, PxFilterData & queryFilter) const
+{
+    queryFilter = PxFilterData();
+    queryFilter.word0 = collisionLayer_;
+    queryFilter.word1 = collisionMask_;
+    simulationFilter = queryFilter;
+    //contact reports are used only by simulation filter shader
+    simulationFilter.word3 = contactReportFlags_;
+    RigidActor* actor = rigidActor_ ? rigidActor_.Get() : (node_ ? node_->GetDerivedComponent<RigidActor>() : nullptr);
+    if (actor)
+        simulationFilter.word3 |= actor->GetContactReportFlags();
+}
+
+PxShapeFlags Urho3DPhysX::CollisionShape::GetShapeFlags() const
+{
+    PxShapeFlags flags = PxShapeFlag::eVISUALIZATION | PxShapeFlag::eSCENE_QUERY_SHAPE;
+    if (enabled_)
+        flags |= trigger_ ? PxShapeFlag::eTRIGGER_SHAPE : PxShapeFlag::eSIMULATION_SHAPE;
+    return flags;
+}
+
+PxTransform Urho3DPhysX::CollisionShape::GetLocalPose() const
+{
+    if (shapeType_ == PLANE_SHAPE)
+        return PxTransformFromPlaneEquation(PxPlane(ToPxVec3(position_), ToPxVec3(planeNormal_)));
+    return PxTransform(ToPxVec3(position_), ToPxQuat(rotation_));
+}
+
+bool Urho3DPhysX::CollisionShape::CreateGeometry(PxGeometryHolder & geometry)
+{
+    cachedWorldScale_ = node_->GetWorldScale();
+    switch (shapeType_)
+    {
+    case Urho3DPhysX::BOX_SHAPE:
+        geometry = PxBoxGeometry(ToPxVec3(size_ * cachedWorldScale_ * 0.5f));
+        return true;
+    case Urho3DPhysX::SPHERE_SHAPE:
+        geometry = PxSphereGeometry(size_.x_ * cachedWorldScale_.x_ * 0.5f);
+        return true;
+    case Urho3DPhysX::PLANE_SHAPE:
+        geometry = PxPlaneGeometry();
+        return true;
+    case Urho3DPhysX::CAPSULE_SHAPE:
+        geometry = PxCapsuleGeometry(size_.x_ * cachedWorldScale_.x_ * 0.5f, size_.y_ * cachedWorldScale_.y_ * 0.5f);
+        return true;
+    case Urho3DPhysX::CONVEXMESH_SHAPE:
+        return CreateMeshGeometry(geometry, true);
+    case Urho3DPhysX::TRIANGLEMESH_SHAPE:
+        return CreateMeshGeometry(geometry, false);
+    default:
+        return false;
+    }
+}
+
+bool Urho3DPhysX::CollisionShape::CreateMeshGeometry(PxGeometryHolder & geometry, bool convex)
+{
+    Model* sourceModel = FindSourceModel();
+    if (!sourceModel)
+        return false;
+    auto* physics = GetSubsystem<Physics>();
+    SharedPtr<CookedMesh> mesh(asyncCooking_ ? physics->RequestMesh(sourceModel, modelLodLevel_, convex, this, cookingFlags_) :
+        physics->GetOrCreateMesh(sourceModel, modelLodLevel_, convex, cookingFlags_));
+    //new mesh is referenced before previous one is released
+    physics->ReleaseMesh(cookedMesh_);
+    cookedMesh_ = mesh;
+    if (!mesh)
+        return false;
+    PxMeshScale scale = ToPxVec3(node_->GetWorldScale());
+    if (convex)
+        geometry = PxConvexMeshGeometry(mesh->GetConvexMesh(), scale);
+    else
+        geometry = PxTriangleMeshGeometry(mesh->GetTriangleMesh(), scale);
+    return true;
+}
+
+void Urho3DPhysX::CollisionShape::UpdateShapePose()
+{
+    if (shape_)
+    {
+        PxTransform pose = GetLocalPose();
+        if (sharedShape_)
+        {
+            if (!(shape_->getLocalPose() == pose))
+                MarkShapeDirty();
+            return;
         }
+        shape_->setLocalPose(pose);
         if (rigidActor_)
         {
             RigidBody* rigidBody = rigidActor_->Cast<RigidBody>();
             if (rigidBody)
-                rigidBody->UpdateMassAndInertia();
+                rigidBody->MarkDirty();
         }
     }
 }
@@ -300,11 +472,32 @@ void Urho3DPhysX::CollisionShape::ReleaseShape()
         if (rigidActor_)
         {
             rigidActor_->GetActor()->detachShape(*shape_);
+            if (rigidActor_->GetPhysXScene())
+                rigidActor_->GetPhysXScene()->RemoveFromContactEvents(this);
+        }
+        if (sharedShape_)
+        {
+            //pool is released before shapes when Physics subsystem is destroyed
+            auto* physics = GetSubsystem<Physics>();
+            if (physics)
+                physics->ReleaseSharedShape(shape_);
+            sharedShape_ = false;
+        }
+        else
+        {
+            shape_->userData = nullptr;
+            shape_->release();
         }
-        shape_->userData = nullptr;
-        shape_->release();
         shape_ = nullptr;
     }
+    if (cookedMesh_)
+    {
+        auto* physics = GetSubsystem<Physics>();
+        if (physics)
+            physics->ReleaseMesh(cookedMesh_);
+        else
+            cookedMesh_.Reset();
+    }
 }
 
 void Urho3DPhysX::CollisionShape::SetMaterial(PhysXMaterial * material)
@@ -315,10 +508,16 @@ void Urho3DPhysX::CollisionShape::SetMaterial(PhysXMaterial * material)
     }
     else
     {
+        bool changed = material != material_;
         material_ = SharedPtr<PhysXMaterial>(material);
         PxMaterial* mat[1];
         mat[0] = material_->GetMaterial();
-        if(shape_)
+        if (sharedShape_)
+        {
+            if (changed)
+                MarkShapeDirty();
+        }
+        else if(shape_)
             shape_->setMaterials(mat, 1);        
     }
 }
@@ -334,7 +533,7 @@ void Urho3DPhysX::CollisionShape::SetShapeType(PhysXShapeType shape)
     if (shapeType_ != shape)
     {
         shapeType_ = shape;
-        UpdateShape();
+        MarkShapeDirty();
     }
 }
 
@@ -355,14 +554,16 @@ void Urho3DPhysX::CollisionShape::SetSize(const Vector3 & size)
     if (size != size_)
     {
         size_ = size;
-        UpdateSize();
+        //pending rebuild will use new size
+        if (!geometryDirty_ && shape_)
+            UpdateSize();
     }
 }
 
 void Urho3DPhysX::CollisionShape::SetPlaneNormal(const Vector3 & normal)
 {
     planeNormal_ = normal;
-    if (shapeType_ = PLANE_SHAPE)
+    if (shapeType_ == PLANE_SHAPE)
         UpdateShapePose();
 }
 
@@ -372,7 +573,7 @@ void Urho3DPhysX::CollisionShape::SetBox(const Vector3 & size, const Vector3 & p
     size_ = size;
     position_ = position;
     rotation_ = rotation;
-    UpdateShape();
+    MarkShapeDirty();
 }
 
 void Urho3DPhysX::CollisionShape::SetSphere(float radius, const Vector3 & position, const Quaternion & rotation)
@@ -381,7 +582,7 @@ void Urho3DPhysX::CollisionShape::SetSphere(float radius, const Vector3 & positi
     size_ = Vector3(radius, radius, radius);
     position_ = position;
     rotation_ = rotation;
-    UpdateShape();
+    MarkShapeDirty();
 }
 
 void Urho3DPhysX::CollisionShape::SetCapsule(float diamater, float height, const Vector3 & position, const Quaternion & rotation)
@@ -390,51 +591,33 @@ void Urho3DPhysX::CollisionShape::SetCapsule(float diamater, float height, const
     size_ = Vector3(diamater, height, diamater);
     position_ = position;
     rotation_ = rotation;
-    UpdateShape();
+    MarkShapeDirty();
 }
 
 bool Urho3DPhysX::CollisionShape::CreateTriangleMesh()
 {
     if (shape_)
         ReleaseShape();
-    Model* sourceModel = FindSourceModel();
-    if (sourceModel)
+    PxGeometryHolder geometry;
+    if (node_ && material_ && CreateMeshGeometry(geometry, false))
     {
-        auto* physics = GetSubsystem<Physics>();
-        PxTriangleMesh* triMesh = physics->GetOrCreateTriangleMesh(sourceModel, modelLodLevel_);
-        if (triMesh)
-        {
-            cachedWorldScale_ = node_->GetWorldScale();
-            PxMeshScale scale = ToPxVec3(cachedWorldScale_);
-            PxTriangleMeshGeometry geom(triMesh, scale);
-            shape_ = physics->GetPhysics()->createShape(geom, *material_->GetMaterial(), true);
-            if (shape_)
-                return true;
-        }
+        cachedWorldScale_ = node_->GetWorldScale();
+        shape_ = GetSubsystem<Physics>()->GetPhysics()->createShape(geometry.any(), *material_->GetMaterial(), true);
     }
-    return false;
+    return shape_ != nullptr;
 }
 
 bool Urho3DPhysX::CollisionShape::CreateConvexMesh()
 {
     if (shape_)
         ReleaseShape();
-    Model* sourceModel = FindSourceModel();
-    if (sourceModel)
+    PxGeometryHolder geometry;
+    if (node_ && material_ && CreateMeshGeometry(geometry, true))
     {
-        auto* physics = GetSubsystem<Physics>();
-        PxConvexMesh* convexMesh = physics->GetOrCreateConvexMesh(sourceModel, modelLodLevel_);
-        if (convexMesh)
-        {
-            cachedWorldScale_ = node_->GetWorldScale();
-            PxMeshScale scale = ToPxVec3(cachedWorldScale_);
-            PxConvexMeshGeometry geom(convexMesh, scale);
-            shape_ = physics->GetPhysics()->createShape(geom, *material_->GetMaterial(), true);
-            if (shape_)
-                return true;
-        }
+        cachedWorldScale_ = node_->GetWorldScale();
+        shape_ = GetSubsystem<Physics>()->GetPhysics()->createShape(geometry.any(), *material_->GetMaterial(), true);
     }
-    return false;
+    return shape_ != nullptr;
 }
 
 void Urho3DPhysX::CollisionShape::SetTrigger(bool trigger)
@@ -442,7 +625,9 @@ void Urho3DPhysX::CollisionShape::SetTrigger(bool trigger)
     if (trigger_ != trigger)
     {
         trigger_ = trigger;
-        if (shape_)
+        if (sharedShape_)
+            MarkShapeDirty();
+        else if (shape_)
         {
             shape_->setFlag(PxShapeFlag::eSIMULATION_SHAPE, !trigger_);
             shape_->setFlag(PxShapeFlag::eTRIGGER_SHAPE, trigger_);
@@ -450,7 +635,7 @@ void Urho3DPhysX::CollisionShape::SetTrigger(bool trigger)
             {
                 RigidBody* rigidBody = rigidActor_->Cast<RigidBody>();
                 if (rigidBody)
-                    rigidBody->UpdateMassAndInertia();
+                    rigidBody->MarkDirty();
             }
         }
     }
@@ -461,14 +646,7 @@ void Urho3DPhysX::CollisionShape::SetCollisionLayer(unsigned layer)
     if (collisionLayer_ != layer)
     {
         collisionLayer_ = layer;
-        if (shape_)
-        {
-            PxFilterData filter;
-            filter.word0 = collisionLayer_;
-            filter.word1 = collisionMask_;
-            shape_->setSimulationFilterData(filter);
-            shape_->setQueryFilterData(filter);
-        }
+        UpdateFilterData();
     }
 }
 
@@ -477,14 +655,7 @@ void Urho3DPhysX::CollisionShape::SetCollisionMask(unsigned mask)
     if (collisionMask_ != mask)
     {
         collisionMask_ = mask;
-        if (shape_)
-        {
-            PxFilterData filter;
-            filter.word0 = collisionLayer_;
-            filter.word1 = collisionMask_;
-            shape_->setSimulationFilterData(filter);
-            shape_->setQueryFilterData(filter);
-        }
+        UpdateFilterData();
     }
 }
 
@@ -495,7 +666,7 @@ void Urho3DPhysX::CollisionShape::SetCustomModel(Model* model)
         customModel_ = SharedPtr<Model>(model);
         if (customModel_ && (shapeType_ == TRIANGLEMESH_SHAPE || shapeType_ == CONVEXMESH_SHAPE))
         {
-            UpdateShape();
+            MarkShapeDirty();
         }
     }
 }
@@ -511,7 +682,17 @@ void Urho3DPhysX::CollisionShape::SetModelLODLevel(unsigned value)
     {
         modelLodLevel_ = value;
         if (shapeType_ == TRIANGLEMESH_SHAPE || shapeType_ == CONVEXMESH_SHAPE)
-            UpdateShape();
+            MarkShapeDirty();
+    }
+}
+
+void Urho3DPhysX::CollisionShape::SetCookingFlags(unsigned flags)
+{
+    if (flags != cookingFlags_)
+    {
+        cookingFlags_ = flags;
+        if (shapeType_ == TRIANGLEMESH_SHAPE || shapeType_ == CONVEXMESH_SHAPE)
+            MarkShapeDirty();
     }
 }
 
@@ -532,7 +713,7 @@ ResourceRef Urho3DPhysX::CollisionShape::GetMaterialAttr() const
 
 void Urho3DPhysX::CollisionShape::OnMarkedDirty(Node * node)
 {
-    if (shape_)
+    if (shape_ && !geometryDirty_)
     {
         if (rigidActor_ && rigidActor_->IsApplyingTransform())
             return;
@@ -543,6 +724,21 @@ void Urho3DPhysX::CollisionShape::OnMarkedDirty(Node * node)
     }
 }
 
+void Urho3DPhysX::CollisionShape::OnMeshCooked(bool success)
+{
+    if (!meshPending_)
+        return;
+    meshPending_ = false;
+    if (!success)
+    {
+        URHO3D_LOGERROR("Failed to create mesh for collision shape, shape will remain detached.");
+        return;
+    }
+    //mesh is ready now, recreate shape - it will be attached to the actor and mass will be updated
+    if (shapeType_ == TRIANGLEMESH_SHAPE || shapeType_ == CONVEXMESH_SHAPE)
+        UpdateShape();
+}
+
 void Urho3DPhysX::CollisionShape::SetActor(RigidActor * actor)
 {
     if (actor != rigidActor_)
@@ -552,11 +748,45 @@ void Urho3DPhysX::CollisionShape::SetActor(RigidActor * actor)
             /*TODO: this situation is not desired, but if happend, require some clean up*/
         }
         rigidActor_ = WeakPtr<RigidActor>(actor);
+        UpdateFilterData();
+    }
+}
+
+void Urho3DPhysX::CollisionShape::SetContactReportFlags(unsigned flags)
+{
+    if (contactReportFlags_ != flags)
+    {
+        contactReportFlags_ = flags;
+        UpdateFilterData();
+    }
+}
+
+void Urho3DPhysX::CollisionShape::UpdateFilterData()
+{
+    if (shape_)
+    {
+        PxFilterData simulationFilter;
+        PxFilterData queryFilter;
+        GetFilterData(simulationFilter, queryFilter);
+        if (sharedShape_)
+        {
+            //layer or reports differ from pooled shape, other one is used
+            if (!(shape_->getSimulationFilterData() == simulationFilter) || !(shape_->getQueryFilterData() == queryFilter))
+                MarkShapeDirty();
+            return;
+        }
+        shape_->setQueryFilterData(queryFilter);
+        shape_->setSimulationFilterData(simulationFilter);
     }
 }
 
 void Urho3DPhysX::CollisionShape::UpdateSize()
 {
+    if (sharedShape_)
+    {
+        MarkShapeDirty();
+        return;
+    }
     cachedWorldScale_ = node_->GetWorldScale();
     switch (shapeType_)
     {
@@ -585,7 +815,7 @@ void Urho3DPhysX::CollisionShape::UpdateSize()
     {
         RigidBody* rigidBody = rigidActor_->Cast<RigidBody>();
         if (rigidBody)
-            rigidBody->UpdateMassAndInertia();
+            rigidBody->MarkDirty();
     }        
 }
 
@@ -3,6 +3,7 @@
 #include "PhysXUtils.h"
 #include <Urho3D/Scene/Component.h>
 #include <PxShape.h>
+#include <geometry/PxGeometryHelpers.h>
 
 namespace Urho3D
 {
@@ -16,6 +17,7 @@ namespace Urho3DPhysX
 {
     class RigidActor;
     class PhysXMaterial;
+    struct CookedMesh;
 
     enum URHOPX_API PhysXShapeType
     {
@@ -27,10 +29,44 @@ namespace Urho3DPhysX
         TRIANGLEMESH_SHAPE
     };
 
+    ///Contact reports and modification requested for pairs with given shape, flags of both shapes in pair are combined
+    enum URHOPX_API PhysXContactReportFlag
+    {
+        CR_NONE = 0x0,
+        CR_TOUCH_FOUND = 0x1,
+        CR_TOUCH_PERSISTS = 0x2,
+        CR_TOUCH_LOST = 0x4,
+        ///report contact points with touch events
+        CR_CONTACT_POINTS = 0x8,
+        ///pass contacts to scene's PhysXContactModifier before solving
+        CR_MODIFY_CONTACTS = 0x10,
+        ///report contacts with force above DynamicBody's contact report threshold
+        CR_FORCE_THRESHOLD = 0x20,
+        CR_DEFAULT = CR_TOUCH_FOUND | CR_TOUCH_LOST
+    };
+
+    ///Mesh cooking options of collision shape. Meshes cooked with different options are cached separately, only MC_DIRECT_INSERTION applies to convex meshes
+    enum URHOPX_API PhysXMeshCookingFlag
+    {
+        MC_DEFAULT = 0x0,
+        ///insert cooked mesh directly into PhysX without serializing it, meshes cooked this way are not stored in disk cache
+        MC_DIRECT_INSERTION = 0x1,
+        ///skip removal of duplicate vertices and degenerate triangles, source mesh must not contain them
+        MC_DISABLE_CLEANING = 0x2,
+        ///use BVH34 midphase structure, faster to build than default BVH33
+        MC_BVH34 = 0x4,
+        ///don't precompute active edges from triangle adjacency
+        MC_NO_ADJACENCY = 0x8,
+        ///fastest cooking, intended for procedural and destructible meshes rebuilt at runtime
+        MC_RUNTIME = MC_DIRECT_INSERTION | MC_DISABLE_CLEANING | MC_BVH34 | MC_NO_ADJACENCY
+    };
+
     class URHOPX_API CollisionShape : public Component
     {
         URHO3D_OBJECT(CollisionShape, Component);
         friend class RigidActor;
+        friend class Physics;
+        friend class PhysXScene;
     public:
         CollisionShape(Context* context);
         ~CollisionShape();
@@ -43,14 +79,28 @@ namespace Urho3DPhysX
         void OnNodeSet(Node* node) override;
         ///
         void OnSetEnabled() override;
-        ///(re)create shape. Created shape will be exclusive (TODO: add support for shared shapes).
+        ///(re)create shape. Shape is taken from Physics shape pool if sharing is enabled, otherwise it's exclusive.
         void UpdateShape();
+        ///Apply pending geometry changes now. Otherwise they are applied in ApplyAttributes or before next simulation step.
+        void ApplyShapeChanges();
+        ///Check if geometry changes are waiting to be applied
+        bool IsShapeDirty() const { return geometryDirty_; }
         void UpdateShapePose();
         void ReleaseShape();
         PhysXMaterial* GetMaterial() { return material_; }
         void SetMaterial(PhysXMaterial* material);
         void SetDefaultMaterial();
+        ///Get PhysX shape. Shared shape must not be modified directly
         PxShape* GetShape() { return shape_; }
+        ///Enable sharing PxShape with other collision shapes with the same geometry, material, pose, filter data and flags. False by default.
+        ///Shared PxShape has no user data, so finding its CollisionShape from query hits and contacts needs a search of actor node components
+        void SetShared(bool enable);
+        ///
+        bool IsShared() const { return shared_; }
+        ///Check if current PxShape is shared, shared shape has no user data
+        bool IsUsingSharedShape() const { return sharedShape_; }
+        ///Get actor this shape is attached to
+        RigidActor* GetRigidActor() const { return rigidActor_; }
         void SetShapeType(PhysXShapeType shape);
         PhysXShapeType GetShapeType() const { return shapeType_; }
         void SetPosition(const Vector3& position);
@@ -83,6 +133,10 @@ namespace Urho3DPhysX
         void SetCollisionMask(unsigned mask);
         ///
         unsigned GetCollisionMask() const { return collisionMask_; }
+        ///Set contact reports (PhysXContactReportFlag) for this shape, actor's flags are added to them
+        void SetContactReportFlags(unsigned flags);
+        ///
+        unsigned GetContactReportFlags() const { return contactReportFlags_; }
         ///
         void SetCustomModel(Model* model);
         ///
@@ -95,13 +149,43 @@ namespace Urho3DPhysX
         void SetModelLODLevel(unsigned value);
         ///
         ResourceRef GetCustomModelAttr() const;
+        ///Cook mesh on worker thread, shape stays detached until cooking is finished
+        void SetAsyncCooking(bool enable) { asyncCooking_ = enable; }
+        ///
+        bool IsAsyncCooking() const { return asyncCooking_; }
+        ///Set mesh cooking options (PhysXMeshCookingFlag)
+        void SetCookingFlags(unsigned flags);
+        ///
+        unsigned GetCookingFlags() const { return cookingFlags_; }
+        ///Check if shape is waiting for mesh cooked in background
+        bool IsMeshPending() const { return meshPending_; }
         ///
         void SetMaterialAttr(const ResourceRef& material);
         ///
         ResourceRef GetMaterialAttr() const;
     private:
         void OnMarkedDirty(Node* node) override;
+        ///Called by Physics when background cooking of requested mesh is finished
+        void OnMeshCooked(bool success);
         void SetActor(RigidActor* actor);
+        ///Mark geometry for rebuild, shapes in scene are rebuilt once for many changes
+        void MarkShapeDirty();
+        ///Create geometry of current type, size and world scale
+        bool CreateGeometry(PxGeometryHolder& geometry);
+        ///Get cooked mesh of source model and create mesh geometry
+        bool CreateMeshGeometry(PxGeometryHolder& geometry, bool convex);
+        ///Check if shape can be taken from the pool
+        bool CanShareShape() const;
+        ///Get shape from the pool, shape_ stays null if it can't be used
+        void AcquireSharedShape(const PxGeometryHolder& geometry);
+        ///
+        void GetFilterData(PxFilterData& simulationFilter, PxFilterData& queryFilter) const;
+        ///Shape flags for current trigger and enabled state
+        PxShapeFlags GetShapeFlags() const;
+        ///
+        PxTransform GetLocalPose() const;
+        ///Set layer, mask and contact report flags to PhysX shape
+        void UpdateFilterData();
         void UpdateSize();
         void UpdateBoxSize();
         void UpdateSphereSize();
@@ -121,9 +205,26 @@ namespace Urho3DPhysX
         bool trigger_;
         unsigned collisionLayer_;
         unsigned collisionMask_;
+        unsigned contactReportFlags_;
         //model
         SharedPtr<Model> customModel_;
         //model lod level
         unsigned modelLodLevel_;
+        ///cooked mesh used by the shape, keeps it in mesh cache
+        SharedPtr<CookedMesh> cookedMesh_;
+        ///cook meshes on worker thread
+        bool asyncCooking_;
+        ///mesh cooking options
+        unsigned cookingFlags_;
+        ///waiting for mesh cooked in background
+        bool meshPending_;
+        ///geometry must be updated
+        bool geometryDirty_;
+        ///waiting in scene's list of dirty shapes
+        bool shapeQueued_;
+        ///use shape pool
+        bool shared_;
+        ///shape_ is taken from the pool
+        bool sharedShape_;
     };
 }
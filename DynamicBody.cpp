@@ -115,7 +115,8 @@ float Urho3DPhysX::DynamicBody::GetSleepThreshold() const
 
 bool Urho3DPhysX::DynamicBody::IsSleeping() const
 {
-    if (!pxScene_ || kinematic_)
+    //actor waiting for deferred insertion isn't in PhysX scene yet
+    if (!pxScene_ || kinematic_ || !actor_->getScene())
         return true;
     PxRigidDynamic* rigidDynamic = actor_->is<PxRigidDynamic>();
     return rigidDynamic ? rigidDynamic->isSleeping() : true;
@@ -123,7 +124,8 @@ bool Urho3DPhysX::DynamicBody::IsSleeping() const
 
 void Urho3DPhysX::DynamicBody::WakeUp()
 {
-    if (!pxScene_ || kinematic_)
+    //actor waiting for deferred insertion isn't in PhysX scene yet
+    if (!pxScene_ || kinematic_ || !actor_->getScene())
         return;
     PxRigidDynamic* rigidDynamic = actor_->is<PxRigidDynamic>();
     if(rigidDynamic)
@@ -132,7 +134,8 @@ void Urho3DPhysX::DynamicBody::WakeUp()
 
 void Urho3DPhysX::DynamicBody::PutToSleep()
 {
-    if (!pxScene_ || kinematic_)
+    //actor waiting for deferred insertion isn't in PhysX scene yet
+    if (!pxScene_ || kinematic_ || !actor_->getScene())
         return;
     PxRigidDynamic* rigidDynamic = actor_->is<PxRigidDynamic>();
     if (rigidDynamic)
@@ -292,13 +295,6 @@ bool Urho3DPhysX::DynamicBody::GetKinematicTarget(Vector3 & position, Quaternion
     return false;
 }
 
-void Urho3DPhysX::DynamicBody::OnMarkedDirty(Node * node)
-{
-    RigidBody::OnMarkedDirty(node);
-    if(IsSleeping() && !kinematic_)
-        WakeUp();
-}
-
 void Urho3DPhysX::DynamicBody::OnJointAdded(Joint * joint)
 {
     if (joint)
@@ -90,8 +90,6 @@ namespace Urho3DPhysX
         ///
         bool GetKinematicTarget(Vector3& position, Quaternion& rotation);
     protected:
-        ///
-        void OnMarkedDirty(Node* node) override;
         ///
         void OnJointAdded(Joint* joint) override;
         ///
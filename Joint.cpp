@@ -10,22 +10,22 @@
 static const float DEF_BREAK_FORCE = PX_MAX_F32;
 
 Urho3DPhysX::Joint::Joint(Context * context) : Component(context),
+ownActor_(nullptr),
+otherActor_(nullptr),
+otherNodeID_(0),
 joint_(nullptr),
 position_(Vector3::ZERO),
 rotation_(Quaternion::IDENTITY),
 otherPosition_(Vector3::ZERO),
 otherRotation_(Quaternion::IDENTITY),
-ownActor_(nullptr),
-otherActor_(nullptr),
-otherNodeID_(0),
-needCreation_(true),
 breakForce_(DEF_BREAK_FORCE),
 breakTorque_(DEF_BREAK_FORCE),
 stiffness_(0.0f),
 damping_(0.0f),
 useSoftLimit_(true),
 enableCollision_(true),
-otherActorNodeID_(0)
+otherActorNodeID_(0),
+needCreation_(true)
 {
 }
 
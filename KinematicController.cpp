@@ -26,25 +26,25 @@ static const float DEF_CTRL_BOX_FE = 0.5f;
 
 Urho3DPhysX::KinematicController::KinematicController(Context* context) : Component(context),
 controller_(nullptr),
-controllerType_(CAPSULE_CONTROLLER),
 pxScene_(nullptr),
-hitCallback_(nullptr),
-behaviorCallback_(nullptr),
+controllerType_(CAPSULE_CONTROLLER),
 position_(Vector3::ZERO),
+stepOffset_(DEF_CTRL_STEP_OFFSET),
+contactOffset_(DEF_CTRL_CONTACT_OFFSET),
 upDirection_(Vector3::UP),
 slopeLimit_(DEF_CTRL_SLOPE_LIMIT),
-contactOffset_(DEF_CTRL_CONTACT_OFFSET),
-stepOffset_(DEF_CTRL_STEP_OFFSET),
 capsuleHeight_(DEF_CTRL_CAPSULE_H),
 capsuleRadius_(DEF_CTRL_CAPSULE_R),
-nonWalkableMode_(PREV_CLIMBING),
 boxHalfHeight_(DEF_CTRL_BOX_H),
 boxHalfSideExtend_(DEF_CTRL_BOX_SE),
 boxHalfForwardExtend_(DEF_CTRL_BOX_FE),
-recreatingNeeded_(true),
-nodeFromFoot_(false),
 collisionLayer_(0x1),
 collisionMask_(M_MAX_UNSIGNED),
+nodeFromFoot_(false),
+recreatingNeeded_(true),
+nonWalkableMode_(PREV_CLIMBING),
+hitCallback_(nullptr),
+behaviorCallback_(nullptr),
 lastPosition_(Vector3::ZERO),
 isMoving_(false)
 {
@@ -389,7 +389,10 @@ void Urho3DPhysX::KinematicController::UpdateCollisionLayerAndMask()
         actor->getShapes(&shape, 1);
         if (shape)
         {
-            shape->setSimulationFilterData(filterData_);
+            //contact reports are set only for simulation, filterData_ is also used for controller queries
+            PxFilterData simulationFilter = filterData_;
+            simulationFilter.word3 = CR_DEFAULT;
+            shape->setSimulationFilterData(simulationFilter);
             shape->userData = this;
         }
     }
@@ -476,7 +479,9 @@ void Urho3DPhysX::KinematicController::OnShapeHit(const PxControllerShapeHit& hi
     eventData[P_CONTROLLER] = this;
     WeakPtr<RigidActor> actor(static_cast<RigidActor*>(hit.actor->userData));
     eventData[P_ACTOR] = actor;
-    WeakPtr<CollisionShape> shape(static_cast<CollisionShape*>(hit.shape->userData));
+    //shared shapes have no user data
+    CollisionShape* collisionShape = hit.shape->userData ? static_cast<CollisionShape*>(hit.shape->userData) : (actor ? actor->GetCollisionShape(hit.shape) : nullptr);
+    WeakPtr<CollisionShape> shape(collisionShape);
     eventData[P_SHAPE] = shape;
     eventData[P_POSITION] = ToVector3(hit.worldPos);
     eventData[P_NORMAL] = ToVector3(hit.worldNormal);
@@ -532,6 +537,8 @@ void Urho3DPhysX::KinematicController::ReleaseController()
 {
     if (controller_)
     {
+        if (pxScene_)
+            pxScene_->RemoveFromContactEvents(this);
         controller_->release();
         controller_ = nullptr;
     }
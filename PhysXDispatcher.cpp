@@ -0,0 +1,144 @@
+#include "PhysXDispatcher.h"
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Core/Thread.h>
+
+namespace Urho3DPhysX
+{
+    ///Priority of worker items. Above regular work items, so PhysX tasks don't wait behind them while main thread waits for results,
+    ///below M_MAX_UNSIGNED, so WorkQueue::Complete(M_MAX_UNSIGNED) used for per frame engine work doesn't wait for them.
+    ///Workers end when task graph is finished, so Complete with lower priority that runs them on main thread returns too.
+    static const unsigned DISPATCHER_PRIORITY = M_MAX_UNSIGNED - 1;
+}
+
+Urho3DPhysX::WorkQueueDispatcher::WorkQueueDispatcher(WorkQueue* queue, unsigned maxWorkers) :
+workQueue_(queue),
+numWorkers_(0),
+activeWorkers_(0),
+runningTasks_(0),
+numExecutedTasks_(0)
+{
+    if (queue)
+    {
+        numWorkers_ = queue->GetNumThreads();
+        if (maxWorkers)
+            numWorkers_ = Min(numWorkers_, maxWorkers);
+    }
+}
+
+Urho3DPhysX::WorkQueueDispatcher::~WorkQueueDispatcher()
+{
+    //workers which didn't get a thread are not needed anymore, WorkQueue destroyed before dispatcher has no threads left to run them
+    unsigned numRemoved = 0;
+    if (!workQueue_)
+        numRemoved = activeWorkers_;
+    else if (!workItems_.Empty())
+        numRemoved = workQueue_->RemoveWorkItems(workItems_);
+    std::unique_lock<std::mutex> lock(tasksMutex_);
+    activeWorkers_ -= numRemoved;
+    tasksCondition_.wait(lock, [this] { return activeWorkers_ == 0; });
+    //tasks left by removed workers
+    while (!tasks_.Empty())
+    {
+        PxBaseTask* task = tasks_.Back();
+        tasks_.Pop();
+        ++numExecutedTasks_;
+        lock.unlock();
+        task->run();
+        task->release();
+        lock.lock();
+    }
+}
+
+void Urho3DPhysX::WorkQueueDispatcher::submitTask(PxBaseTask& task)
+{
+    bool canStartWorkers = numWorkers_ && workQueue_ && Thread::IsMainThread();
+    bool queued = false;
+    bool startWorkers = false;
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex_);
+        //task submitted by running task is always picked up, at least its own worker is still active
+        if (activeWorkers_ || canStartWorkers)
+        {
+            tasks_.Push(&task);
+            tasksCondition_.notify_one();
+            queued = true;
+            startWorkers = canStartWorkers && activeWorkers_ < numWorkers_;
+        }
+        else
+            ++numExecutedTasks_;
+    }
+    if (startWorkers)
+        StartWorkers();
+    else if (!queued)
+    {
+        //no worker to execute the task
+        task.run();
+        task.release();
+    }
+}
+
+PxU32 Urho3DPhysX::WorkQueueDispatcher::getWorkerCount() const
+{
+    return numWorkers_;
+}
+
+void Urho3DPhysX::WorkQueueDispatcher::StartWorkers()
+{
+    //work items can be added only from main thread, so tasks submitted by workers are executed by workers started here
+    unsigned numStarted;
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex_);
+        numStarted = numWorkers_ - Min(activeWorkers_, numWorkers_);
+        activeWorkers_ += numStarted;
+    }
+    for (unsigned i = workItems_.Size(); i-- > 0;)
+    {
+        if (workItems_[i]->completed_)
+            workItems_.Erase(i);
+    }
+    for (unsigned i = 0; i < numStarted; ++i)
+    {
+        SharedPtr<WorkItem> item(new WorkItem());
+        item->workFunction_ = WorkerWork;
+        item->aux_ = this;
+        item->priority_ = DISPATCHER_PRIORITY;
+        item->sendEvent_ = false;
+        workItems_.Push(item);
+        workQueue_->AddWorkItem(item);
+    }
+}
+
+void Urho3DPhysX::WorkQueueDispatcher::WorkerWork(const WorkItem* item, unsigned threadIndex)
+{
+    static_cast<WorkQueueDispatcher*>(item->aux_)->Worker();
+}
+
+void Urho3DPhysX::WorkQueueDispatcher::Worker()
+{
+    std::unique_lock<std::mutex> lock(tasksMutex_);
+    for (;;)
+    {
+        if (!tasks_.Empty())
+        {
+            PxBaseTask* task = tasks_.Back();
+            tasks_.Pop();
+            ++runningTasks_;
+            ++numExecutedTasks_;
+            lock.unlock();
+            task->run();
+            //release may submit continuation, task counts as running until it returns
+            task->release();
+            lock.lock();
+            --runningTasks_;
+        }
+        else if (runningTasks_)
+            tasksCondition_.wait(lock);
+        else
+        {
+            //task graph is finished, wake waiting workers so they end too
+            --activeWorkers_;
+            tasksCondition_.notify_all();
+            return;
+        }
+    }
+}
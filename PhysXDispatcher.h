@@ -0,0 +1,57 @@
+#pragma once
+#include "PhysXUtils.h"
+#include <Urho3D/Container/Ptr.h>
+#include <Urho3D/Container/Vector.h>
+#include <task/PxCpuDispatcher.h>
+#include <task/PxTask.h>
+#include <mutex>
+#include <condition_variable>
+
+namespace Urho3D
+{
+    class WorkQueue;
+    struct WorkItem;
+}
+
+using namespace Urho3D;
+using namespace physx;
+
+namespace Urho3DPhysX
+{
+    ///Cpu dispatcher executing PhysX tasks on Urho3D WorkQueue threads, so PhysX doesn't create its own thread pool.
+    ///Tasks submitted from main thread (simulate, collide, advance) start worker items, tasks submitted by running tasks are picked up by them.
+    ///Workers block while other tasks may still submit continuations and return their WorkQueue thread when task graph is finished.
+    class URHOPX_API WorkQueueDispatcher : public PxCpuDispatcher
+    {
+    public:
+        ///Max workers = 0 will use all WorkQueue threads.
+        WorkQueueDispatcher(WorkQueue* queue, unsigned maxWorkers = 0);
+        ~WorkQueueDispatcher();
+
+        void submitTask(PxBaseTask& task) override;
+        PxU32 getWorkerCount() const override;
+        ///Number of tasks executed since creation
+        unsigned GetNumExecutedTasks() const { return numExecutedTasks_; }
+
+    private:
+        ///Work item function, runs worker
+        static void WorkerWork(const WorkItem* item, unsigned threadIndex);
+        ///Execute submitted tasks until none is queued or running
+        void Worker();
+        ///Add work items for workers that aren't running yet, main thread only
+        void StartWorkers();
+        WeakPtr<WorkQueue> workQueue_;
+        unsigned numWorkers_;
+        ///number of worker items queued or running
+        unsigned activeWorkers_;
+        ///number of tasks being executed by workers, they may submit continuations
+        unsigned runningTasks_;
+        ///work items of started workers, WorkQueue items are not pooled so they can be removed safely
+        Vector<SharedPtr<WorkItem> > workItems_;
+        PODVector<PxBaseTask*> tasks_;
+        std::mutex tasksMutex_;
+        ///signaled when task is submitted or task graph is finished
+        std::condition_variable tasksCondition_;
+        unsigned numExecutedTasks_;
+    };
+}
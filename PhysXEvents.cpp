@@ -61,6 +61,21 @@ void Urho3DPhysX::SimulationEventCallback::onAdvance(const PxRigidBody * const *
 {
 }
 
+Urho3DPhysX::ContactModifyCallback::ContactModifyCallback() :
+    modifier_(nullptr)
+{
+}
+
+Urho3DPhysX::ContactModifyCallback::~ContactModifyCallback()
+{
+}
+
+void Urho3DPhysX::ContactModifyCallback::onContactModify(PxContactModifyPair * const pairs, PxU32 count)
+{
+    if (modifier_)
+        modifier_->OnModifyContacts(pairs, count);
+}
+
 Urho3DPhysX::BroadPhaseCallback::BroadPhaseCallback(PhysXScene * scene) : 
     scene_(scene)
 {
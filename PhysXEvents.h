@@ -3,6 +3,7 @@
 #include <Urho3D/Core/Object.h>
 #include <foundation/PxErrorCallback.h>
 #include <PxSimulationEventCallback.h>
+#include <PxContactModifyCallback.h>
 #include <PxBroadPhase.h>
 #include <characterkinematic/PxController.h>
 
@@ -22,6 +23,22 @@ URHO3D_EVENT(E_PX_PRESIMULATION, PhysXPreSimulation)
     URHO3D_PARAM(P_TIMESTEP, TimeStep);
 }
 
+///Sent in split stepping mode while collision detection runs on worker threads. Game logic (AI, animation) handled here overlaps with broadphase and narrowphase,
+///scene queries return state before the step. Node moves are applied before solver, apply forces in E_PX_POSTCOLLIDE.
+URHO3D_EVENT(E_PX_COLLIDING, PhysXColliding)
+{
+    URHO3D_PARAM(P_PHYSX_SCENE, PhysXScene);
+    URHO3D_PARAM(P_TIMESTEP, TimeStep);
+}
+
+///Sent in split stepping mode after collision detection, before solver. Forces and velocities set here are used by the current step.
+///Contact events of the step are not available yet, they are reported when results are fetched.
+URHO3D_EVENT(E_PX_POSTCOLLIDE, PhysXPostCollide)
+{
+    URHO3D_PARAM(P_PHYSX_SCENE, PhysXScene);
+    URHO3D_PARAM(P_TIMESTEP, TimeStep);
+}
+
 URHO3D_EVENT(E_COLLISIONSTART, CollisionStart)
 {
     URHO3D_PARAM(P_PHYSX_SCENE, PhysXScene);
@@ -99,6 +116,7 @@ namespace Urho3DPhysX
     class Physics;
     class PhysXScene;
     class KinematicController;
+    class PhysXContactModifier;
 
     class ErrorCallback : public PxErrorCallback
     {
@@ -129,6 +147,22 @@ namespace Urho3DPhysX
         PhysXScene* scene_;
     };
 
+    class ContactModifyCallback : public PxContactModifyCallback
+    {
+    public:
+        ContactModifyCallback();
+        ~ContactModifyCallback();
+
+        void onContactModify(PxContactModifyPair* const pairs, PxU32 count) override;
+        ///
+        void SetModifier(PhysXContactModifier* modifier) { modifier_ = modifier; }
+        ///
+        PhysXContactModifier* GetModifier() const { return modifier_; }
+
+    private:
+        PhysXContactModifier* modifier_;
+    };
+
     class BroadPhaseCallback : public PxBroadPhaseCallback
     {
     public:
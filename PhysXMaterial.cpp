@@ -13,10 +13,10 @@ static const float DEF_STATIC_FRICTION = 1.0f;
 static const float DEF_MAT_RESTITUTION = 0.3f;
 
 Urho3DPhysX::PhysXMaterial::PhysXMaterial(Context * context) : Resource(context),
-xmlLoadFile_(nullptr),
 dynamicFriction_(DEF_DYNAMIC_FRICTION),
 staticFriction_(DEF_STATIC_FRICTION),
-restitution_(DEF_MAT_RESTITUTION)
+restitution_(DEF_MAT_RESTITUTION),
+xmlLoadFile_(nullptr)
 {
     auto* physics = GetSubsystem<Physics>();
     auto* px = physics->GetPhysics();
@@ -9,15 +9,28 @@
 #include <Urho3D/Scene/SceneEvents.h>
 #include <Urho3D/Scene/Scene.h>
 #include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Core/Thread.h>
 #include <Urho3D/Graphics/DebugRenderer.h>
 #include <Urho3D/IO/Log.h>
 #include <characterkinematic/PxControllerManager.h>
+#include <extensions/PxShapeExt.h>
+#include <PxPruningStructure.h>
+#include <PxRigidStatic.h>
 
 namespace Urho3DPhysX
 {
     static const float DEF_FPS = 60.0f;
     static const Vector3 DEF_GRAVITY = Vector3(0.0f, -9.81f, 0.0f);
-    static const unsigned MAX_RAYCAST_HITS = 64;
+    ///touches reported by PhysX in one batch before they are moved to results
+    static const unsigned STREAMING_HITS_BUFFER_SIZE = 32;
+    static const char* steppingModeNames[] =
+    {
+        "Synchronous",
+        "Overlapped",
+        "Split",
+        nullptr
+    };
     //
     static PxFilterFlags physxSceneFilterShader(PxFilterObjectAttributes attributes0, PxFilterData filterData0,
         PxFilterObjectAttributes attributes1, PxFilterData filterData1,
@@ -31,10 +44,29 @@ namespace Urho3DPhysX
         }
         if ((filterData0.word0 & filterData1.word1) && (filterData1.word0 & filterData0.word1))
         {
-            pairFlags = PxPairFlag::eCONTACT_DEFAULT //default: eSOLVE_CONTACT | eDETECT_DISCRETE_CONTACT
-                | PxPairFlag::eTRIGGER_DEFAULT  //notify contact start and end
-                | PxPairFlag::eNOTIFY_TOUCH_PERSISTS
-                | PxPairFlag::eMODIFY_CONTACTS; //for later use (impl modify contact callback)
+            //trigger shapes always report enter and leave
+            if (PxFilterObjectIsTrigger(attributes0) || PxFilterObjectIsTrigger(attributes1))
+            {
+                pairFlags = PxPairFlag::eTRIGGER_DEFAULT;
+                return PxFilterFlag::eDEFAULT;
+            }
+            pairFlags = PxPairFlag::eCONTACT_DEFAULT; //default: eSOLVE_CONTACT | eDETECT_DISCRETE_CONTACT
+            //contact reports requested by any of the shapes (word3)
+            PxU32 reportFlags = filterData0.word3 | filterData1.word3;
+            if (reportFlags & CR_TOUCH_FOUND)
+                pairFlags |= PxPairFlag::eNOTIFY_TOUCH_FOUND;
+            if (reportFlags & CR_TOUCH_PERSISTS)
+                pairFlags |= PxPairFlag::eNOTIFY_TOUCH_PERSISTS;
+            if (reportFlags & CR_TOUCH_LOST)
+                pairFlags |= PxPairFlag::eNOTIFY_TOUCH_LOST;
+            if (reportFlags & CR_CONTACT_POINTS)
+                pairFlags |= PxPairFlag::eNOTIFY_CONTACT_POINTS;
+            //uses contact report threshold of dynamic bodies
+            if (reportFlags & CR_FORCE_THRESHOLD)
+                pairFlags |= PxPairFlag::eNOTIFY_THRESHOLD_FORCE_FOUND;
+            //contacts are passed to PhysXContactModifier
+            if (reportFlags & CR_MODIFY_CONTACTS)
+                pairFlags |= PxPairFlag::eMODIFY_CONTACTS;
             if(PxFilterObjectIsKinematic(attributes0) && PxFilterObjectIsKinematic(attributes1))
             {
                 pairFlags &= ~PxPairFlag::eSOLVE_CONTACT;
@@ -48,12 +80,186 @@ namespace Urho3DPhysX
         return PxFilterFlag::eDEFAULT;
     }
 
-    static bool ComparePhysXRaycastResults(const PhysXRaycastResult& lhs, const PhysXRaycastResult& rhs)
+    static const unsigned DEF_MIN_BATCH_QUERIES_PER_THREAD = 32;
+    ///below this number of active actors poses are read on main thread only
+    static const unsigned MIN_ACTIVE_TRANSFORMS_PER_THREAD = 256;
+    ///below this number of dirty bodies mass is computed on main thread only
+    static const unsigned MIN_MASS_UPDATES_PER_THREAD = 64;
+
+    ///Skips shapes of given actor, used when querying with actor's own shape
+    class IgnoreActorQueryFilter : public PxQueryFilterCallback
+    {
+    public:
+        IgnoreActorQueryFilter(const PxRigidActor* actor) :
+            actor_(actor)
+        {
+        }
+
+        PxQueryHitType::Enum preFilter(const PxFilterData& filterData, const PxShape* shape, const PxRigidActor* actor, PxHitFlags& queryFlags) override
+        {
+            return actor == actor_ ? PxQueryHitType::eNONE : PxQueryHitType::eBLOCK;
+        }
+
+        PxQueryHitType::Enum postFilter(const PxFilterData& filterData, const PxQueryHit& hit) override
+        {
+            return PxQueryHitType::eBLOCK;
+        }
+
+    private:
+        const PxRigidActor* actor_;
+    };
+
+    ///shared shapes have no user data, owner is found among collision shapes of the actor
+    static CollisionShape* GetCollisionShape(const PxShape* shape, const PxActor* actor)
+    {
+        if (shape->userData)
+            return static_cast<CollisionShape*>(shape->userData);
+        RigidActor* rigidActor = actor ? static_cast<RigidActor*>(actor->userData) : nullptr;
+        return rigidActor ? rigidActor->GetCollisionShape(shape) : nullptr;
+    }
+
+    ///fills all but shape of the result, reads only user data, so it's safe on worker threads
+    static void SetQueryHit(PhysXRaycastResult& result, const PxLocationHit& hit)
+    {
+        result.actor_ = static_cast<RigidActor*>(hit.actor->userData);
+        result.distance_ = hit.distance;
+        result.normal_ = hit.flags & PxHitFlag::eNORMAL ? ToVector3(hit.normal) : Vector3::ZERO;
+        result.position_ = hit.flags & PxHitFlag::ePOSITION ? ToVector3(hit.position) : Vector3::ZERO;
+        result.faceIndex_ = hit.flags & PxHitFlag::eFACE_INDEX ? hit.faceIndex : M_MAX_UNSIGNED;
+    }
+
+    static void SetQueryResult(PhysXRaycastResult& result, const PxLocationHit& hit)
+    {
+        SetQueryHit(result, hit);
+        result.shape_ = GetCollisionShape(hit.shape, hit.actor);
+    }
+
+    ///multipleHits - report all hits as touches, used by queries returning more than one hit
+    static PxQueryFilterData GetQueryFilterData(unsigned mask, const PhysXQueryOptions& options, bool multipleHits)
+    {
+        PxQueryFilterData filter;
+        filter.data.word0 = mask;
+        filter.flags = PxQueryFlags();
+        if (options.queryStatic_)
+            filter.flags |= PxQueryFlag::eSTATIC;
+        if (options.queryDynamic_)
+            filter.flags |= PxQueryFlag::eDYNAMIC;
+        if (options.anyHit_)
+            filter.flags |= PxQueryFlag::eANY_HIT;
+        else if (multipleHits)
+            filter.flags |= PxQueryFlag::eNO_BLOCK;
+        return filter;
+    }
+
+    static void ResetContactEvent(PhysXContactEvent& event, PhysXContactEventType type)
+    {
+        event.type_ = type;
+        event.actor_ = nullptr;
+        event.shape_ = nullptr;
+        event.otherActor_ = nullptr;
+        event.otherShape_ = nullptr;
+        event.controller_ = nullptr;
+        event.normal_ = Vector3::ZERO;
+        event.impulse_ = Vector3::ZERO;
+        event.contactPointsStart_ = 0;
+        event.numContactPoints_ = 0;
+    }
+
+    ///controller shapes store KinematicController as user data and are marked with word2 of simulation filter data
+    static void SetContactEventShape(PxShape* pxShape, PxActor* pxActor, CollisionShape*& shape, KinematicController*& controller)
+    {
+        if (pxShape->getSimulationFilterData().word2 == 1)
+            controller = static_cast<KinematicController*>(pxShape->userData);
+        else
+            shape = GetCollisionShape(pxShape, pxActor);
+    }
+
+    static void SetQueryResult(PhysXOverlapResult& result, const PxOverlapHit& hit)
+    {
+        result.actor_ = static_cast<RigidActor*>(hit.actor->userData);
+        result.shape_ = GetCollisionShape(hit.shape, hit.actor);
+    }
+
+    static bool IsCloser(const PhysXRaycastResult& lhs, const PhysXRaycastResult& rhs)
     {
         return lhs.distance_ < rhs.distance_;
     }
 
-    static const PxHitFlags DEF_RAYCAST_FLAGS = PxHitFlag::ePOSITION | PxHitFlag::eNORMAL;
+    ///overlap hits have no distance
+    static bool IsCloser(const PhysXOverlapResult& lhs, const PhysXOverlapResult& rhs)
+    {
+        return false;
+    }
+
+    ///Moves hits directly to caller's results as PhysX reports them, so number of hits isn't limited by fixed buffer
+    template <class HitType, class ResultType> class StreamingHitCallback : public PxHitCallback<HitType>
+    {
+    public:
+        ///When keepClosest is set and maxHits reached, farther results are replaced by closer hits, otherwise query stops after maxHits
+        StreamingHitCallback(PODVector<ResultType>& results, unsigned maxHits, bool keepClosest) :
+            PxHitCallback<HitType>(touches_, STREAMING_HITS_BUFFER_SIZE),
+            results_(results),
+            maxHits_(maxHits ? maxHits : M_MAX_UNSIGNED),
+            keepClosest_(keepClosest),
+            farthest_(0)
+        {
+            results_.Clear();
+        }
+
+        PxAgain processTouches(const HitType* buffer, PxU32 nbHits) override
+        {
+            for (PxU32 i = 0; i < nbHits; ++i)
+            {
+                if (!AddHit(buffer[i]))
+                    return false;
+            }
+            return true;
+        }
+
+        void finalizeQuery() override
+        {
+            //only when user filter returns block hits
+            if (this->hasBlock)
+                AddHit(this->block);
+        }
+
+    private:
+        bool AddHit(const HitType& hit)
+        {
+            if (results_.Size() < maxHits_)
+            {
+                results_.Resize(results_.Size() + 1);
+                SetQueryResult(results_.Back(), hit);
+                if (keepClosest_ && IsCloser(results_[farthest_], results_.Back()))
+                    farthest_ = results_.Size() - 1;
+                return keepClosest_ || results_.Size() < maxHits_;
+            }
+            //partial selection of closest hits
+            ResultType result;
+            SetQueryResult(result, hit);
+            if (IsCloser(result, results_[farthest_]))
+            {
+                results_[farthest_] = result;
+                for (unsigned i = 0; i < results_.Size(); ++i)
+                {
+                    if (IsCloser(results_[farthest_], results_[i]))
+                        farthest_ = i;
+                }
+            }
+            return true;
+        }
+
+        HitType touches_[STREAMING_HITS_BUFFER_SIZE];
+        PODVector<ResultType>& results_;
+        unsigned maxHits_;
+        bool keepClosest_;
+        unsigned farthest_;
+    };
+
+    static bool CompareRaycastResults(const PhysXRaycastResult& lhs, const PhysXRaycastResult& rhs)
+    {
+        return lhs.distance_ < rhs.distance_;
+    }
 
     bool DefCtrlFilterCallback::filter(const PxController& a, const PxController& b)
     {
@@ -69,17 +275,29 @@ namespace Urho3DPhysX
 
 Urho3DPhysX::PhysXScene::PhysXScene(Context * context) : Component(context),
 pxScene_(nullptr),
-fps_(DEF_FPS),
-gravity_(DEF_GRAVITY),
-broadPhaseCallback_(this),
 simulationEventCallback_(this),
-debugDrawEnabled_(false),
+broadPhaseCallback_(this),
+isSimulating_(false),
+steppingMode_(SYNCHRONOUS_STEPPING),
+resultsPending_(false),
+isInCollisionPhase_(false),
+stepTimeUSec_(0),
+fps_(DEF_FPS),
 maxSubsteps_(0),
 timeAcc_(0.0f),
+gravity_(DEF_GRAVITY),
 processSimEvents_(true),
+debugDrawEnabled_(false),
+deferredInsertion_(false),
+pruningStructure_(nullptr),
 controllerManager_(nullptr),
-isSimulating_(false),
-fixedStep_(0.0f)
+fixedStep_(0.0f),
+lastStepTime_(0.0f),
+averageStepTime_(0.0f),
+activeActors_(nullptr),
+numSyncedNodes_(0),
+interpolation_(false),
+interpolationStep_(0)
 {
 }
 
@@ -96,6 +314,9 @@ void Urho3DPhysX::PhysXScene::RegisterObject(Context * context)
     URHO3D_ACCESSOR_ATTRIBUTE("Gravity", GetGravity, SetGravity, Vector3, DEF_GRAVITY, AM_DEFAULT);
     URHO3D_ATTRIBUTE("FPS", float, fps_, DEF_FPS, AM_DEFAULT);
     URHO3D_ATTRIBUTE("Max substeps", int, maxSubsteps_, 0, AM_DEFAULT);
+    URHO3D_ENUM_ACCESSOR_ATTRIBUTE("Stepping mode", GetSteppingMode, SetSteppingMode, PhysXSteppingMode, steppingModeNames, SYNCHRONOUS_STEPPING, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Deferred insertion", IsDeferredInsertion, SetDeferredInsertion, bool, false, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Interpolation", IsInterpolating, SetInterpolation, bool, false, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Sim events enabled", IsProcessingSimulationEvents, SetProcessSimulationEvents, bool, true, AM_DEFAULT);
 }
 
@@ -104,8 +325,10 @@ void Urho3DPhysX::PhysXScene::DrawDebugGeometry(DebugRenderer * debug, bool dept
     URHO3D_PROFILE(PhysXDebug);
     if (!debugDrawEnabled_)
         return;
-    if (debug)
+    if (debug && pxScene_)
     {
+        //render buffer is not accessible while simulating
+        FetchResults();
         const PxRenderBuffer& rb = pxScene_->getRenderBuffer();
         for (PxU32 i = 0; i < rb.getNbLines(); i++)
         {
@@ -132,6 +355,10 @@ void Urho3DPhysX::PhysXScene::Update(float timeStep)
     URHO3D_PROFILE(PhysXUpdate);
     if (!pxScene_)
         return;
+    //step started in previous frame is normally fetched at the beginning of the frame
+    FetchResults();
+    if (!pendingActors_.Empty() && !(GetScene() && GetScene()->IsAsyncLoading()))
+        FlushPendingActors();
     float internalTimeStep = 1.0f / fps_;
     int maxSubsteps = (int)(timeStep * fps_) + 1;
     if (maxSubsteps_ < 0)
@@ -142,103 +369,379 @@ void Urho3DPhysX::PhysXScene::Update(float timeStep)
     else if (maxSubsteps_ > 0)
         maxSubsteps = Min(maxSubsteps, maxSubsteps_);
 
-    isSimulating_ = true;
     timeAcc_ += timeStep;
     while (timeAcc_ >= internalTimeStep && maxSubsteps > 0)
     {
-        fixedStep_ = internalTimeStep;
-        //pre simulation event
+        if (isSimulating_)
+            EndStep();
+        BeginStep(internalTimeStep);
+        --maxSubsteps;
+    }
+    //in overlapped mode last substep keeps running while the frame is rendered
+    if (steppingMode_ != OVERLAPPED_STEPPING)
+        FetchResults();
+    if (interpolation_)
+        InterpolateTransforms();
+}
+
+void Urho3DPhysX::PhysXScene::SetInterpolation(bool enable)
+{
+    if (interpolation_ != enable)
+    {
+        interpolation_ = enable;
+        if (!interpolation_)
         {
-            using namespace PhysXPreSimulation;
-            VariantMap& eventData = GetEventDataMap();
-            eventData[P_PHYSX_SCENE] = this;
-            eventData[P_TIMESTEP] = internalTimeStep;
-            auto* scene = GetScene();
-            if(scene)
-                scene->SendEvent(E_PX_PRESIMULATION, eventData);
+            //finish at last simulated poses
+            while (!interpolatedActors_.Empty())
+            {
+                RigidActor* actor = interpolatedActors_.Back();
+                actor->ApplyWorldTransform(actor->targetPosition_, actor->targetRotation_);
+                RemoveInterpolatedActor(actor);
+            }
         }
-        pxScene_->simulate(internalTimeStep);
-        timeAcc_ -= internalTimeStep;
-        --maxSubsteps;
-        if (!pxScene_->fetchResults(true))
+    }
+}
+
+void Urho3DPhysX::PhysXScene::FetchResults()
+{
+    //step cannot be completed from its own split stepping events
+    if (isInCollisionPhase_)
+        return;
+    if (isSimulating_)
+        EndStep();
+    if (resultsPending_)
+        ApplyResults();
+}
+
+void Urho3DPhysX::PhysXScene::SetSteppingMode(PhysXSteppingMode mode)
+{
+    if (steppingMode_ != mode)
+    {
+        FetchResults();
+        steppingMode_ = mode;
+    }
+}
+
+void Urho3DPhysX::PhysXScene::BeginStep(float timeStep)
+{
+    fixedStep_ = timeStep;
+    SendStepEvent(E_PX_PRESIMULATION, timeStep);
+    if (steppingMode_ == SPLIT_STEPPING)
+    {
+        stepTimer_.Reset();
+        isSimulating_ = true;
+        isInCollisionPhase_ = true;
+        FlushDirtyShapes();
+        FlushDirtyMasses();
+        FlushDirtyTransforms();
+        pxScene_->collide(timeStep);
+        stepTimeUSec_ += stepTimer_.GetUSec(false);
+        //collision detection runs on worker threads while game logic handles this event
+        SendStepEvent(E_PX_COLLIDING, timeStep);
         {
-            //__debugbreak();
+            URHO3D_PROFILE(PhysXFetchCollision);
+            stepTimer_.Reset();
+            pxScene_->fetchCollision(true);
+            stepTimeUSec_ += stepTimer_.GetUSec(false);
         }
+        SendStepEvent(E_PX_POSTCOLLIDE, timeStep);
+        //PhysX buffers writes made after fetchCollision and applies them in advance, so masses, poses
+        //and kinematic targets changed by post collide handlers are used by the solver of this step.
+        //Shape changes can't be applied while simulating and stay queued for next step.
+        stepTimer_.Reset();
+        FlushDirtyMasses();
+        FlushDirtyTransforms();
+        isInCollisionPhase_ = false;
+        pxScene_->advance();
+    }
+    else
+    {
+        FlushDirtyShapes();
+        FlushDirtyMasses();
+        FlushDirtyTransforms();
+        stepTimer_.Reset();
+        isSimulating_ = true;
+        pxScene_->simulate(timeStep);
     }
+    timeAcc_ -= timeStep;
+    stepTimeUSec_ += stepTimer_.GetUSec(false);
+}
+
+void Urho3DPhysX::PhysXScene::SendStepEvent(StringHash eventType, float timeStep)
+{
+    using namespace PhysXPreSimulation;
+    VariantMap& eventData = GetEventDataMap();
+    eventData[P_PHYSX_SCENE] = this;
+    eventData[P_TIMESTEP] = timeStep;
+    auto* scene = GetScene();
+    if(scene)
+        scene->SendEvent(eventType, eventData);
+}
 
+void Urho3DPhysX::PhysXScene::EndStep()
+{
+    URHO3D_PROFILE(PhysXFetchResults);
+    //events of previously applied results stay available until next results are fetched
+    if (!resultsPending_)
+    {
+        contactEvents_.Clear();
+        contactPoints_.Clear();
+    }
+    stepTimer_.Reset();
+    if (!pxScene_->fetchResults(true))
+    {
+        //__debugbreak();
+    }
+    stepTimeUSec_ += stepTimer_.GetUSec(false);
     isSimulating_ = false;
+    resultsPending_ = true;
+}
+
+void Urho3DPhysX::PhysXScene::ApplyResults()
+{
+    resultsPending_ = false;
+    lastStepTime_ = stepTimeUSec_ / 1000.0f;
+    averageStepTime_ = Lerp(averageStepTime_, lastStepTime_, 0.1f);
+    stepTimeUSec_ = 0;
+
+    SyncActiveTransforms();
+    ProcessContactEvents();
+}
+
+void Urho3DPhysX::PhysXScene::SyncActiveTransforms()
+{
+    URHO3D_PROFILE(PhysXSyncTransforms);
     PxU32 numActiveActors;
-    PxActor** acitveActors = pxScene_->getActiveActors(numActiveActors);
-    for (PxU32 i = 0; i < numActiveActors; i++)
+    activeActors_ = pxScene_->getActiveActors(numActiveActors);
+    activeTransforms_.Resize(numActiveActors);
+    auto* queue = GetSubsystem<WorkQueue>();
+    //work items can be added only from main thread
+    unsigned numThreads = queue && Thread::IsMainThread() ? queue->GetNumThreads() + 1 : 1;
+    unsigned numItems = Min(numThreads, numActiveActors / MIN_ACTIVE_TRANSFORMS_PER_THREAD);
+    if (numItems > 1)
+    {
+        unsigned actorsPerItem = numActiveActors / numItems;
+        for (unsigned i = 0; i < numItems; ++i)
+        {
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = ReadActiveTransformsWork;
+            item->aux_ = this;
+            item->start_ = reinterpret_cast<void*>((size_t)(i * actorsPerItem));
+            item->end_ = reinterpret_cast<void*>((size_t)(i + 1 < numItems ? (i + 1) * actorsPerItem : numActiveActors));
+            queue->AddWorkItem(item);
+        }
+        queue->Complete(M_MAX_UNSIGNED);
+    }
+    else
+        ReadActiveTransforms(0, numActiveActors);
+    activeActors_ = nullptr;
+
+    if (interpolation_)
+    {
+        //nodes are written every frame by InterpolateTransforms
+        UpdateInterpolationTargets();
+        return;
+    }
+    //nodes are written on main thread, once per active actor
+    numSyncedNodes_ = 0;
+    for (auto& transform : activeTransforms_)
+    {
+        if (transform.actor_ && !transform.actor_->IsNodeDriven())
+        {
+            transform.actor_->ApplyWorldTransform(transform.position_, transform.rotation_);
+            ++numSyncedNodes_;
+        }
+    }
+}
+
+void Urho3DPhysX::PhysXScene::UpdateInterpolationTargets()
+{
+    ++interpolationStep_;
+    for (auto& transform : activeTransforms_)
+    {
+        RigidActor* actor = transform.actor_;
+        if (!actor || actor->IsNodeDriven())
+            continue;
+        if (actor->interpolationIndex_ == M_MAX_UNSIGNED)
+        {
+            //start from currently displayed pose
+            actor->previousPosition_ = actor->lastPosition_;
+            actor->previousRotation_ = actor->lastRotation_;
+            actor->interpolationIndex_ = interpolatedActors_.Size();
+            interpolatedActors_.Push(actor);
+        }
+        else
+        {
+            actor->previousPosition_ = actor->targetPosition_;
+            actor->previousRotation_ = actor->targetRotation_;
+        }
+        actor->targetPosition_ = transform.position_;
+        actor->targetRotation_ = transform.rotation_;
+        actor->interpolationStep_ = interpolationStep_;
+    }
+    //actors that weren't active in this step stop at their last pose
+    for (unsigned i = interpolatedActors_.Size(); i-- > 0;)
     {
-        RigidActor* a = static_cast<RigidActor*>(acitveActors[i]->userData);
-        if (a)
+        RigidActor* actor = interpolatedActors_[i];
+        if (actor->interpolationStep_ != interpolationStep_)
         {
-            a->ApplyWorldTransformFromActor();
+            actor->ApplyWorldTransform(actor->targetPosition_, actor->targetRotation_);
+            RemoveInterpolatedActor(actor);
         }
     }
-    ProcessTriggers();
-    ProcessCollisions();
+}
+
+void Urho3DPhysX::PhysXScene::InterpolateTransforms()
+{
+    URHO3D_PROFILE(PhysXInterpolateTransforms);
+    //with variable time step nothing is left in accumulator, show last step
+    float t = maxSubsteps_ < 0 || fixedStep_ <= 0.0f ? 1.0f : Clamp(timeAcc_ / fixedStep_, 0.0f, 1.0f);
+    for (auto* actor : interpolatedActors_)
+        actor->ApplyWorldTransform(actor->previousPosition_.Lerp(actor->targetPosition_, t), actor->previousRotation_.Slerp(actor->targetRotation_, t));
+    numSyncedNodes_ = interpolatedActors_.Size();
+}
+
+void Urho3DPhysX::PhysXScene::RemoveInterpolatedActor(RigidActor * actor)
+{
+    unsigned index = actor->interpolationIndex_;
+    if (index >= interpolatedActors_.Size())
+        return;
+    RigidActor* last = interpolatedActors_.Back();
+    interpolatedActors_[index] = last;
+    last->interpolationIndex_ = index;
+    interpolatedActors_.Pop();
+    actor->interpolationIndex_ = M_MAX_UNSIGNED;
+}
+
+void Urho3DPhysX::PhysXScene::ReadActiveTransforms(unsigned start, unsigned end)
+{
+    for (unsigned i = start; i < end; ++i)
+    {
+        //scene contains only rigid actors
+        PxRigidActor* pxActor = static_cast<PxRigidActor*>(activeActors_[i]);
+        ActiveTransform& transform = activeTransforms_[i];
+        transform.actor_ = static_cast<RigidActor*>(pxActor->userData);
+        const PxTransform pose = pxActor->getGlobalPose();
+        transform.position_ = ToVector3(pose.p);
+        transform.rotation_ = ToQuaternion(pose.q);
+    }
+}
+
+void Urho3DPhysX::PhysXScene::ReadActiveTransformsWork(const WorkItem * item, unsigned threadIndex)
+{
+    auto* scene = static_cast<PhysXScene*>(item->aux_);
+    scene->ReadActiveTransforms((unsigned)(size_t)item->start_, (unsigned)(size_t)item->end_);
 }
 
 void Urho3DPhysX::PhysXScene::AddActor(RigidActor * actor)
 {
+    if (!actor || actor->sceneIndex_ != M_MAX_UNSIGNED)
+        return;
+    actor->sceneIndex_ = rigidActors_.Size();
     rigidActors_.Push(actor);
-    pxScene_->addActor(*actor->GetActor());
+    if (deferredInsertion_ || (GetScene() && GetScene()->IsAsyncLoading()))
+    {
+        actor->pendingIndex_ = pendingActors_.Size();
+        pendingActors_.Push(actor);
+    }
+    else
+        pxScene_->addActor(*actor->GetActor());
 }
 
-bool Urho3DPhysX::PhysXScene::Raycast(PODVector<PhysXRaycastResult>& results, const Ray & ray, float maxDistance, unsigned mask)
+void Urho3DPhysX::PhysXScene::SetDeferredInsertion(bool enable)
 {
-    URHO3D_PROFILE(PhysXRaycast);
-    if (pxScene_)
+    deferredInsertion_ = enable;
+}
+
+void Urho3DPhysX::PhysXScene::FlushPendingActors()
+{
+    if (!pxScene_ || pendingActors_.Empty())
+        return;
+    URHO3D_PROFILE(PhysXFlushPendingActors);
+    //actors can't be added while simulating
+    FetchResults();
+    //shapes created from code are built on flush, statics without them would skip the pruning structure
+    FlushDirtyShapes();
+    PODVector<PxActor*> dynamics;
+    pendingStatics_.Clear();
+    for (auto* actor : pendingActors_)
     {
-        PxRaycastBufferN<MAX_RAYCAST_HITS> buffer;
-        PxQueryFilterData filter;
-        filter.data.word0 = mask;
-        if (pxScene_->raycast(ToPxVec3(ray.origin_), ToPxVec3(ray.direction_), Clamp(maxDistance, 0.0f, M_INFINITY), buffer, DEF_RAYCAST_FLAGS, filter))
+        actor->pendingIndex_ = M_MAX_UNSIGNED;
+        PxRigidActor* pxActor = actor->GetActor();
+        //pruning structure requires actors with shapes
+        if (pxActor->is<PxRigidStatic>() && pxActor->getNbShapes())
+            pendingStatics_.Push(pxActor);
+        else
+            dynamics.Push(pxActor);
+    }
+    pendingActors_.Clear();
+
+    //scene query tree of static actors is precomputed on worker thread while dynamic actors are inserted
+    auto* queue = GetSubsystem<WorkQueue>();
+    bool useWorkItem = !pendingStatics_.Empty() && queue && queue->GetNumThreads() && Thread::IsMainThread();
+    if (useWorkItem)
+    {
+        SharedPtr<WorkItem> item = queue->GetFreeItem();
+        item->priority_ = M_MAX_UNSIGNED;
+        item->workFunction_ = BuildPruningStructureWork;
+        item->aux_ = this;
+        queue->AddWorkItem(item);
+    }
+    if (!dynamics.Empty())
+        pxScene_->addActors(&dynamics[0], dynamics.Size());
+    if (!pendingStatics_.Empty())
+    {
+        if (useWorkItem)
+            queue->Complete(M_MAX_UNSIGNED);
+        else
+            pruningStructure_ = GetSubsystem<Physics>()->GetPhysics()->createPruningStructure(&pendingStatics_[0], pendingStatics_.Size());
+        if (pruningStructure_)
         {
-            unsigned numHits = buffer.getNbAnyHits();
-            if (numHits)
-            {
-                results.Clear();
-                results.Reserve(numHits);
-                for (unsigned i = 0; i < numHits; ++i)
-                {
-                    const PxRaycastHit& hit = buffer.getAnyHit(i);
-                    PhysXRaycastResult result;
-                    result.actor_ = static_cast<RigidActor*>(hit.actor->userData);
-                    result.shape_ = static_cast<CollisionShape*>(hit.shape->userData);
-                    result.distance_ = hit.distance;
-                    result.normal_ = ToVector3(hit.normal);
-                    result.position_ = ToVector3(hit.position);
-                    results.Push(result);
-                }
-                Sort(results.Begin(), results.End(), ComparePhysXRaycastResults);
-                return true;
-            }
+            pxScene_->addActors(*pruningStructure_);
+            pruningStructure_->release();
+            pruningStructure_ = nullptr;
         }
+        else
+        {
+            URHO3D_LOGWARNING("Failed to create pruning structure, static actors are added one by one.");
+            for (auto* pxActor : pendingStatics_)
+                pxScene_->addActor(*pxActor);
+        }
+        pendingStatics_.Clear();
     }
-    return false;
 }
 
-bool Urho3DPhysX::PhysXScene::RaycastSingle(PhysXRaycastResult & result, const Ray & ray, float maxDistance, unsigned mask)
+void Urho3DPhysX::PhysXScene::BuildPruningStructureWork(const WorkItem * item, unsigned threadIndex)
+{
+    auto* scene = static_cast<PhysXScene*>(item->aux_);
+    scene->pruningStructure_ = scene->GetSubsystem<Physics>()->GetPhysics()->createPruningStructure(&scene->pendingStatics_[0], scene->pendingStatics_.Size());
+}
+
+bool Urho3DPhysX::PhysXScene::Raycast(PODVector<PhysXRaycastResult>& results, const Ray & ray, float maxDistance, unsigned mask, const PhysXQueryOptions& options)
+{
+    URHO3D_PROFILE(PhysXRaycast);
+    StreamingHitCallback<PxRaycastHit, PhysXRaycastResult> callback(results, options.maxHits_, options.sortByDistance_);
+    if (pxScene_)
+    {
+        pxScene_->raycast(ToPxVec3(ray.origin_), ToPxVec3(ray.direction_), Clamp(maxDistance, 0.0f, M_INFINITY), callback, options.hitFlags_, GetQueryFilterData(mask, options, true));
+        if (options.sortByDistance_)
+            Sort(results.Begin(), results.End(), CompareRaycastResults);
+    }
+    return !results.Empty();
+}
+
+bool Urho3DPhysX::PhysXScene::RaycastSingle(PhysXRaycastResult & result, const Ray & ray, float maxDistance, unsigned mask, const PhysXQueryOptions& options)
 {
     URHO3D_PROFILE(PhysXRaycastSingle);
     if (pxScene_)
     {
         PxRaycastBuffer buffer;
-        PxQueryFilterData filter;
-        filter.data.word0 = mask;
-        if (pxScene_->raycast(ToPxVec3(ray.origin_), ToPxVec3(ray.direction_), Clamp(maxDistance, 0.0f, M_INFINITY), buffer, DEF_RAYCAST_FLAGS, filter))
+        if (pxScene_->raycast(ToPxVec3(ray.origin_), ToPxVec3(ray.direction_), Clamp(maxDistance, 0.0f, M_INFINITY), buffer, options.hitFlags_, GetQueryFilterData(mask, options, false)))
         {
             if (buffer.hasBlock)
             {
-                const PxRaycastHit& block = buffer.block;
-                result.actor_ = static_cast<RigidActor*>(block.actor->userData);
-                result.shape_ = static_cast<CollisionShape*>(block.shape->userData);
-                result.distance_ = block.distance;
-                result.normal_ = ToVector3(block.normal);
-                result.position_ = ToVector3(block.position);
+                SetQueryResult(result, buffer.block);
                 return true;
             }
         }
@@ -246,34 +749,229 @@ bool Urho3DPhysX::PhysXScene::RaycastSingle(PhysXRaycastResult & result, const R
     return false;
 }
 
-bool Urho3DPhysX::PhysXScene::SphereCast(PODVector<PhysXRaycastResult>& results, const Ray & ray, float radius, float maxDistance, unsigned mask)
+bool Urho3DPhysX::PhysXScene::SphereCast(PODVector<PhysXRaycastResult>& results, const Ray & ray, float radius, float maxDistance, unsigned mask, const PhysXQueryOptions& options)
+{
+    return Sweep(results, ray, Quaternion::IDENTITY, PxSphereGeometry(radius), maxDistance, mask, options);
+}
+
+bool Urho3DPhysX::PhysXScene::SphereCastSingle(PhysXRaycastResult & result, const Ray & ray, float radius, float maxDistance, unsigned mask, const PhysXQueryOptions& options)
+{
+    return SweepSingle(result, ray, Quaternion::IDENTITY, PxSphereGeometry(radius), maxDistance, mask, options);
+}
+
+bool Urho3DPhysX::PhysXScene::BoxCast(PODVector<PhysXRaycastResult>& results, const Ray & ray, const Vector3 & size, const Quaternion & rotation, float maxDistance, unsigned mask, const PhysXQueryOptions& options)
+{
+    return Sweep(results, ray, rotation, PxBoxGeometry(ToPxVec3(size * 0.5f)), maxDistance, mask, options);
+}
+
+bool Urho3DPhysX::PhysXScene::BoxCastSingle(PhysXRaycastResult & result, const Ray & ray, const Vector3 & size, const Quaternion & rotation, float maxDistance, unsigned mask, const PhysXQueryOptions& options)
+{
+    return SweepSingle(result, ray, rotation, PxBoxGeometry(ToPxVec3(size * 0.5f)), maxDistance, mask, options);
+}
+
+bool Urho3DPhysX::PhysXScene::CapsuleCast(PODVector<PhysXRaycastResult>& results, const Ray & ray, float radius, float height, const Quaternion & rotation, float maxDistance, unsigned mask, const PhysXQueryOptions& options)
+{
+    return Sweep(results, ray, rotation, PxCapsuleGeometry(radius, height * 0.5f), maxDistance, mask, options);
+}
+
+bool Urho3DPhysX::PhysXScene::CapsuleCastSingle(PhysXRaycastResult & result, const Ray & ray, float radius, float height, const Quaternion & rotation, float maxDistance, unsigned mask, const PhysXQueryOptions& options)
+{
+    return SweepSingle(result, ray, rotation, PxCapsuleGeometry(radius, height * 0.5f), maxDistance, mask, options);
+}
+
+Urho3DPhysX::PhysXScene::QueryBatch::QueryBatch(PhysXScene * scene) :
+scene_(scene),
+results_(nullptr),
+minQueriesPerThread_(DEF_MIN_BATCH_QUERIES_PER_THREAD)
 {
-    return Sweep(results, ray, Quaternion::IDENTITY, PxSphereGeometry(radius), maxDistance, mask);
 }
 
-bool Urho3DPhysX::PhysXScene::SphereCastSingle(PhysXRaycastResult & result, const Ray & ray, float radius, float maxDistance, unsigned mask)
+void Urho3DPhysX::PhysXScene::QueryBatch::AddRaycast(const Ray & ray, float maxDistance, unsigned mask, const PhysXQueryOptions& options)
 {
-    return SweepSingle(result, ray, Quaternion::IDENTITY, PxSphereGeometry(radius), maxDistance, mask);
+    Query query;
+    query.ray_ = ray;
+    query.maxDistance_ = Clamp(maxDistance, 0.0f, M_INFINITY);
+    query.mask_ = mask;
+    query.hitFlags_ = options.hitFlags_;
+    query.queryFlags_ = GetQueryFilterData(mask, options, false).flags;
+    query.isSweep_ = false;
+    queries_.Push(query);
 }
 
-bool Urho3DPhysX::PhysXScene::BoxCast(PODVector<PhysXRaycastResult>& results, const Ray & ray, const Vector3 & size, const Quaternion & rotation, float maxDistance, unsigned mask)
+void Urho3DPhysX::PhysXScene::QueryBatch::AddSphereCast(const Ray & ray, float radius, float maxDistance, unsigned mask, const PhysXQueryOptions& options)
 {
-    return Sweep(results, ray, rotation, PxBoxGeometry(ToPxVec3(size * 0.5f)), maxDistance, mask);
+    AddSweep(ray, Quaternion::IDENTITY, PxSphereGeometry(radius), maxDistance, mask, options);
 }
 
-bool Urho3DPhysX::PhysXScene::BoxCastSingle(PhysXRaycastResult & result, const Ray & ray, const Vector3 & size, const Quaternion & rotation, float maxDistance, unsigned mask)
+void Urho3DPhysX::PhysXScene::QueryBatch::AddBoxCast(const Ray & ray, const Vector3 & size, const Quaternion & rotation, float maxDistance, unsigned mask, const PhysXQueryOptions& options)
 {
-    return SweepSingle(result, ray, rotation, PxBoxGeometry(ToPxVec3(size * 0.5f)), maxDistance, mask);
+    AddSweep(ray, rotation, PxBoxGeometry(ToPxVec3(size * 0.5f)), maxDistance, mask, options);
 }
 
-bool Urho3DPhysX::PhysXScene::CapsuleCast(PODVector<PhysXRaycastResult>& results, const Ray & ray, float radius, float height, const Quaternion & rotation, float maxDistance, unsigned mask)
+void Urho3DPhysX::PhysXScene::QueryBatch::AddCapsuleCast(const Ray & ray, float radius, float height, const Quaternion & rotation, float maxDistance, unsigned mask, const PhysXQueryOptions& options)
 {
-    return Sweep(results, ray, rotation, PxCapsuleGeometry(radius, height * 0.5f), maxDistance, mask);
+    AddSweep(ray, rotation, PxCapsuleGeometry(radius, height * 0.5f), maxDistance, mask, options);
 }
 
-bool Urho3DPhysX::PhysXScene::CapsuleCastSingle(PhysXRaycastResult & result, const Ray & ray, float radius, float height, const Quaternion & rotation, float maxDistance, unsigned mask)
+void Urho3DPhysX::PhysXScene::QueryBatch::AddSweep(const Ray & ray, const Quaternion & rotation, const PxGeometry & geometry, float maxDistance, unsigned mask, const PhysXQueryOptions& options)
 {
-    return SweepSingle(result, ray, rotation, PxCapsuleGeometry(radius, height * 0.5f), maxDistance, mask);
+    Query query;
+    query.ray_ = ray;
+    query.rotation_ = rotation;
+    query.geometry_.storeAny(geometry);
+    query.maxDistance_ = Clamp(maxDistance, 0.0f, M_INFINITY);
+    query.mask_ = mask;
+    query.hitFlags_ = options.hitFlags_;
+    query.queryFlags_ = GetQueryFilterData(mask, options, false).flags;
+    query.isSweep_ = true;
+    queries_.Push(query);
+}
+
+unsigned Urho3DPhysX::PhysXScene::QueryBatch::Execute(PODVector<PhysXRaycastResult>& results)
+{
+    results.Resize(queries_.Size());
+    return Execute(results.Buffer());
+}
+
+unsigned Urho3DPhysX::PhysXScene::QueryBatch::Execute(PhysXRaycastResult * results)
+{
+    URHO3D_PROFILE(PhysXQueryBatch);
+    if (!scene_ || !scene_->pxScene_ || queries_.Empty())
+        return 0;
+    results_ = results;
+    unsigned numQueries = queries_.Size();
+    hitShapes_.Resize(numQueries);
+    auto* queue = scene_->GetSubsystem<WorkQueue>();
+    //work items can be added only from main thread
+    unsigned numThreads = queue && Thread::IsMainThread() ? queue->GetNumThreads() + 1 : 1;
+    unsigned numItems = Min(numThreads, numQueries / minQueriesPerThread_);
+    if (numItems > 1)
+    {
+        unsigned queriesPerItem = numQueries / numItems;
+        for (unsigned i = 0; i < numItems; ++i)
+        {
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = ExecuteRangeWork;
+            item->aux_ = this;
+            item->start_ = reinterpret_cast<void*>((size_t)(i * queriesPerItem));
+            item->end_ = reinterpret_cast<void*>((size_t)(i + 1 < numItems ? (i + 1) * queriesPerItem : numQueries));
+            queue->AddWorkItem(item);
+        }
+        queue->Complete(M_MAX_UNSIGNED);
+    }
+    else
+        ExecuteRange(0, numQueries);
+    results_ = nullptr;
+
+    unsigned numHits = 0;
+    for (unsigned i = 0; i < numQueries; ++i)
+    {
+        //shared shape lookup walks node components, which isn't safe on worker threads
+        if (hitShapes_[i] && !results[i].shape_ && results[i].actor_)
+            results[i].shape_ = results[i].actor_->GetCollisionShape(hitShapes_[i]);
+        if (results[i].actor_ || results[i].shape_)
+            ++numHits;
+    }
+    return numHits;
+}
+
+void Urho3DPhysX::PhysXScene::QueryBatch::ExecuteRange(unsigned start, unsigned end)
+{
+    PxScene* pxScene = scene_->pxScene_;
+    PxQueryFilterData filter;
+    for (unsigned i = start; i < end; ++i)
+    {
+        const Query& query = queries_[i];
+        PhysXRaycastResult& result = results_[i];
+        result.actor_ = nullptr;
+        result.shape_ = nullptr;
+        result.distance_ = M_INFINITY;
+        result.position_ = Vector3::ZERO;
+        result.normal_ = Vector3::ZERO;
+        result.faceIndex_ = M_MAX_UNSIGNED;
+        hitShapes_[i] = nullptr;
+        filter.data.word0 = query.mask_;
+        filter.flags = query.queryFlags_;
+        if (query.isSweep_)
+        {
+            PxSweepBuffer buffer;
+            if (pxScene->sweep(query.geometry_.any(), ToPxTransform(query.ray_.origin_, query.rotation_), ToPxVec3(query.ray_.direction_), query.maxDistance_, buffer, query.hitFlags_, filter) && buffer.hasBlock)
+            {
+                SetQueryHit(result, buffer.block);
+                hitShapes_[i] = buffer.block.shape;
+            }
+        }
+        else
+        {
+            PxRaycastBuffer buffer;
+            if (pxScene->raycast(ToPxVec3(query.ray_.origin_), ToPxVec3(query.ray_.direction_), query.maxDistance_, buffer, query.hitFlags_, filter) && buffer.hasBlock)
+            {
+                SetQueryHit(result, buffer.block);
+                hitShapes_[i] = buffer.block.shape;
+            }
+        }
+        //exclusive shapes store CollisionShape in user data, shared ones are resolved by Execute
+        if (hitShapes_[i])
+            result.shape_ = static_cast<CollisionShape*>(hitShapes_[i]->userData);
+    }
+}
+
+void Urho3DPhysX::PhysXScene::QueryBatch::ExecuteRangeWork(const WorkItem * item, unsigned threadIndex)
+{
+    auto* batch = static_cast<QueryBatch*>(item->aux_);
+    batch->ExecuteRange((unsigned)(size_t)item->start_, (unsigned)(size_t)item->end_);
+}
+
+bool Urho3DPhysX::PhysXScene::OverlapSphere(PODVector<PhysXOverlapResult>& results, const Vector3 & center, float radius, unsigned mask, const PhysXQueryOptions& options)
+{
+    return Overlap(results, PxSphereGeometry(radius), ToPxTransform(center), mask, options);
+}
+
+bool Urho3DPhysX::PhysXScene::OverlapSphereAny(const Vector3 & center, float radius, unsigned mask, const PhysXQueryOptions& options)
+{
+    return OverlapAny(PxSphereGeometry(radius), ToPxTransform(center), mask, options);
+}
+
+bool Urho3DPhysX::PhysXScene::OverlapBox(PODVector<PhysXOverlapResult>& results, const Vector3 & center, const Vector3 & size, const Quaternion & rotation, unsigned mask, const PhysXQueryOptions& options)
+{
+    return Overlap(results, PxBoxGeometry(ToPxVec3(size * 0.5f)), ToPxTransform(center, rotation), mask, options);
+}
+
+bool Urho3DPhysX::PhysXScene::OverlapBoxAny(const Vector3 & center, const Vector3 & size, const Quaternion & rotation, unsigned mask, const PhysXQueryOptions& options)
+{
+    return OverlapAny(PxBoxGeometry(ToPxVec3(size * 0.5f)), ToPxTransform(center, rotation), mask, options);
+}
+
+bool Urho3DPhysX::PhysXScene::OverlapCapsule(PODVector<PhysXOverlapResult>& results, const Vector3 & center, float radius, float height, const Quaternion & rotation, unsigned mask, const PhysXQueryOptions& options)
+{
+    return Overlap(results, PxCapsuleGeometry(radius, height * 0.5f), ToPxTransform(center, rotation), mask, options);
+}
+
+bool Urho3DPhysX::PhysXScene::OverlapCapsuleAny(const Vector3 & center, float radius, float height, const Quaternion & rotation, unsigned mask, const PhysXQueryOptions& options)
+{
+    return OverlapAny(PxCapsuleGeometry(radius, height * 0.5f), ToPxTransform(center, rotation), mask, options);
+}
+
+bool Urho3DPhysX::PhysXScene::OverlapShape(PODVector<PhysXOverlapResult>& results, CollisionShape * shape, unsigned mask, const PhysXQueryOptions& options)
+{
+    PxGeometryHolder geometry;
+    PxTransform pose;
+    if (!GetShapeQueryGeometry(shape, geometry, pose))
+    {
+        results.Clear();
+        return false;
+    }
+    return Overlap(results, geometry.any(), pose, mask, options, shape->GetRigidActor()->GetActor());
+}
+
+bool Urho3DPhysX::PhysXScene::OverlapShapeAny(CollisionShape * shape, unsigned mask, const PhysXQueryOptions& options)
+{
+    PxGeometryHolder geometry;
+    PxTransform pose;
+    if (!GetShapeQueryGeometry(shape, geometry, pose))
+        return false;
+    return OverlapAny(geometry.any(), pose, mask, options, shape->GetRigidActor()->GetActor());
 }
 
 void Urho3DPhysX::PhysXScene::SetDebugDrawEnabled(bool enable)
@@ -281,6 +979,7 @@ void Urho3DPhysX::PhysXScene::SetDebugDrawEnabled(bool enable)
 #ifdef _DEBUG
     if (debugDrawEnabled_ != enable)
     {
+        FetchResults();
         debugDrawEnabled_ = enable;
         pxScene_->setVisualizationParameter(PxVisualizationParameter::eSCALE, debugDrawEnabled_ ? 1.0f : 0.0f);
         pxScene_->setVisualizationParameter(PxVisualizationParameter::eCOLLISION_SHAPES, 1.0f);
@@ -303,78 +1002,296 @@ void Urho3DPhysX::PhysXScene::SetGravity(const Vector3 & gravity)
     {
         gravity_ = gravity;
         if (pxScene_)
+        {
+            FetchResults();
             pxScene_->setGravity(ToPxVec3(gravity_));
+        }
     }
 }
 
 void Urho3DPhysX::PhysXScene::RemoveActor(RigidActor * actor)
 {
-    if (actor && pxScene_)
+    if (actor && pxScene_ && actor->sceneIndex_ < rigidActors_.Size())
     {
-        pxScene_->removeActor(*actor->GetActor());
-        rigidActors_.Remove(actor);
+        //lists are unordered, removed actor is replaced by the last one
+        if (actor->pendingIndex_ < pendingActors_.Size())
+        {
+            RigidActor* lastPending = pendingActors_.Back();
+            pendingActors_[actor->pendingIndex_] = lastPending;
+            lastPending->pendingIndex_ = actor->pendingIndex_;
+            pendingActors_.Pop();
+            actor->pendingIndex_ = M_MAX_UNSIGNED;
+        }
+        else
+            pxScene_->removeActor(*actor->GetActor());
+        //swap with last registered actor
+        RigidActor* last = rigidActors_.Back();
+        rigidActors_[actor->sceneIndex_] = last;
+        last->sceneIndex_ = actor->sceneIndex_;
+        rigidActors_.Pop();
+        actor->sceneIndex_ = M_MAX_UNSIGNED;
+        RemoveFromContactEvents(actor);
+        if (actor->transformDirtyIndex_ < dirtyTransforms_.Size())
+        {
+            RigidActor* lastDirty = dirtyTransforms_.Back();
+            dirtyTransforms_[actor->transformDirtyIndex_] = lastDirty;
+            lastDirty->transformDirtyIndex_ = actor->transformDirtyIndex_;
+            dirtyTransforms_.Pop();
+            actor->transformDirtyIndex_ = M_MAX_UNSIGNED;
+        }
+        RemoveInterpolatedActor(actor);
+        if (actor->massDirtyIndex_ < dirtyMasses_.Size())
+        {
+            RigidBody* lastBody = dirtyMasses_.Back();
+            dirtyMasses_[actor->massDirtyIndex_] = lastBody;
+            lastBody->massDirtyIndex_ = actor->massDirtyIndex_;
+            dirtyMasses_.Pop();
+            actor->massDirtyIndex_ = M_MAX_UNSIGNED;
+        }
     }
 }
 
-void Urho3DPhysX::PhysXScene::AddCollision(const PxContactPairHeader & pairHeader, const PxContactPair * pairs, PxU32 nbPairs)
+void Urho3DPhysX::PhysXScene::MarkMassDirty(RigidBody * body)
 {
-    CollisionData data;
-    auto setCtrlCollision = [](PxRigidActor* actor, CollisionData& data)
+    if (body->massDirtyIndex_ == M_MAX_UNSIGNED)
     {
-        PxShape* shape;
-        actor->getShapes(&shape, 1);
-        if (shape && shape->getSimulationFilterData().word2 == 1)
+        body->massDirtyIndex_ = dirtyMasses_.Size();
+        dirtyMasses_.Push(body);
+    }
+}
+
+void Urho3DPhysX::PhysXScene::FlushDirtyMasses()
+{
+    if (dirtyMasses_.Empty())
+        return;
+    URHO3D_PROFILE(PhysXFlushMasses);
+    unsigned numBodies = dirtyMasses_.Size();
+    massUpdates_.Resize(numBodies);
+    for (unsigned i = 0; i < numBodies; ++i)
+    {
+        massUpdates_[i].body_ = dirtyMasses_[i];
+        dirtyMasses_[i]->massDirtyIndex_ = M_MAX_UNSIGNED;
+    }
+    dirtyMasses_.Clear();
+
+    //mass properties are computed in parallel, PhysX bodies are written on main thread
+    auto* queue = GetSubsystem<WorkQueue>();
+    unsigned numThreads = queue && Thread::IsMainThread() ? queue->GetNumThreads() + 1 : 1;
+    unsigned numItems = Min(numThreads, numBodies / MIN_MASS_UPDATES_PER_THREAD);
+    if (numItems > 1)
+    {
+        unsigned bodiesPerItem = numBodies / numItems;
+        for (unsigned i = 0; i < numItems; ++i)
         {
-            data.isControllerCollision_ = true;
-            data.controller_ = WeakPtr<KinematicController>(static_cast<KinematicController*>(shape->userData));
+            SharedPtr<WorkItem> item = queue->GetFreeItem();
+            item->priority_ = M_MAX_UNSIGNED;
+            item->workFunction_ = ComputeMassUpdatesWork;
+            item->aux_ = this;
+            item->start_ = reinterpret_cast<void*>((size_t)(i * bodiesPerItem));
+            item->end_ = reinterpret_cast<void*>((size_t)(i + 1 < numItems ? (i + 1) * bodiesPerItem : numBodies));
+            queue->AddWorkItem(item);
         }
-    };
-    WeakPtr<RigidActor> a(static_cast<RigidActor*>(pairHeader.actors[0]->userData));
-    if (!a)
-        setCtrlCollision(pairHeader.actors[0], data);
-    WeakPtr<RigidActor> b(static_cast<RigidActor*>(pairHeader.actors[1]->userData));
-    if (!b)
-        setCtrlCollision(pairHeader.actors[1], data);
-    data.actorA_ = a;
-    data.actorB_ = b;
+        queue->Complete(M_MAX_UNSIGNED);
+    }
+    else
+        ComputeMassUpdates(0, numBodies);
+
+    for (auto& update : massUpdates_)
+    {
+        //body could be updated immediately after it was queued
+        if (!update.body_->IsDirty())
+            continue;
+        if (update.computed_)
+            update.body_->ApplyMassProperties(update.properties_);
+        else
+            update.body_->UpdateMassAndInertia();
+    }
+    massUpdates_.Clear();
+}
+
+void Urho3DPhysX::PhysXScene::ComputeMassUpdates(unsigned start, unsigned end)
+{
+    for (unsigned i = start; i < end; ++i)
+    {
+        MassUpdate& update = massUpdates_[i];
+        update.computed_ = update.body_->IsDirty() && update.body_->ComputeMassProperties(update.properties_);
+    }
+}
+
+void Urho3DPhysX::PhysXScene::ComputeMassUpdatesWork(const WorkItem * item, unsigned threadIndex)
+{
+    auto* scene = static_cast<PhysXScene*>(item->aux_);
+    scene->ComputeMassUpdates((unsigned)(size_t)item->start_, (unsigned)(size_t)item->end_);
+}
+
+void Urho3DPhysX::PhysXScene::MarkShapeDirty(CollisionShape * shape)
+{
+    dirtyShapes_.Push(WeakPtr<CollisionShape>(shape));
+}
+
+void Urho3DPhysX::PhysXScene::FlushDirtyShapes()
+{
+    URHO3D_PROFILE(PhysXFlushShapes);
+    for (unsigned i = 0; i < dirtyShapes_.Size(); ++i)
+    {
+        CollisionShape* shape = dirtyShapes_[i];
+        if (shape)
+        {
+            shape->shapeQueued_ = false;
+            //no-op if shape was already rebuilt in ApplyAttributes
+            shape->ApplyShapeChanges();
+        }
+    }
+    dirtyShapes_.Clear();
+}
+
+void Urho3DPhysX::PhysXScene::MarkTransformDirty(RigidActor * actor)
+{
+    actor->transformDirtyIndex_ = dirtyTransforms_.Size();
+    dirtyTransforms_.Push(actor);
+}
+
+void Urho3DPhysX::PhysXScene::FlushDirtyTransforms()
+{
+    URHO3D_PROFILE(PhysXFlushTransforms);
+    for (unsigned i = 0; i < dirtyTransforms_.Size(); ++i)
+    {
+        RigidActor* actor = dirtyTransforms_[i];
+        actor->transformDirtyIndex_ = M_MAX_UNSIGNED;
+        actor->FlushNodeTransform();
+        //teleported actor must not be blended from its old pose
+        if (actor->interpolationIndex_ != M_MAX_UNSIGNED)
+        {
+            actor->previousPosition_ = actor->targetPosition_ = actor->lastPosition_;
+            actor->previousRotation_ = actor->targetRotation_ = actor->lastRotation_;
+        }
+    }
+    dirtyTransforms_.Clear();
+}
+
+void Urho3DPhysX::PhysXScene::AddCollision(const PxContactPairHeader & pairHeader, const PxContactPair * pairs, PxU32 nbPairs)
+{
+    PhysXContactEvent event;
+    ResetContactEvent(event, CONTACT_PERSIST);
+    //actors released while simulating are reported as removed and must not be accessed
+    bool removedA = pairHeader.flags & PxContactPairHeaderFlag::eREMOVED_ACTOR_0;
+    bool removedB = pairHeader.flags & PxContactPairHeaderFlag::eREMOVED_ACTOR_1;
+    if (!removedA)
+        event.actor_ = static_cast<RigidActor*>(pairHeader.actors[0]->userData);
+    if (!removedB)
+        event.otherActor_ = static_cast<RigidActor*>(pairHeader.actors[1]->userData);
+    event.contactPointsStart_ = contactPoints_.Size();
+    bool touchEvents = false;
+    bool forceEvents = false;
     for (unsigned i = 0; i < nbPairs; ++i)
     {
-        if (pairs[i].flags & PxContactPairFlag::eACTOR_PAIR_HAS_FIRST_TOUCH)
-            data.eventType_ = E_COLLISIONSTART;
-        else if (pairs[i].flags & PxContactPairFlag::eACTOR_PAIR_LOST_TOUCH)
-            data.eventType_ = E_COLLISIONEND;
+        const PxContactPair& pair = pairs[i];
+        if (pair.events & (PxPairFlag::eNOTIFY_TOUCH_FOUND | PxPairFlag::eNOTIFY_TOUCH_PERSISTS | PxPairFlag::eNOTIFY_TOUCH_LOST))
+            touchEvents = true;
+        if (pair.events & PxPairFlag::eNOTIFY_THRESHOLD_FORCE_FOUND)
+            forceEvents = true;
+        if (pair.flags & PxContactPairFlag::eACTOR_PAIR_HAS_FIRST_TOUCH)
+            event.type_ = CONTACT_START;
+        else if (pair.flags & PxContactPairFlag::eACTOR_PAIR_LOST_TOUCH)
+            event.type_ = CONTACT_END;
+        if (pair.contactCount)
+            ExtractContactPoints(pair, event);
+        if (!event.shape_ && !removedA && !(pair.flags & PxContactPairFlag::eREMOVED_SHAPE_0))
+            SetContactEventShape(pair.shapes[0], pairHeader.actors[0], event.shape_, event.controller_);
+        if (!event.otherShape_ && !removedB && !(pair.flags & PxContactPairFlag::eREMOVED_SHAPE_1))
+            SetContactEventShape(pair.shapes[1], pairHeader.actors[1], event.otherShape_, event.controller_);
     }
-    collisions_.Push(data);
+    //pair reported only because of force threshold
+    if (forceEvents && !touchEvents)
+        event.type_ = CONTACT_FORCE_THRESHOLD;
+    if (event.numContactPoints_)
+        event.normal_ = contactPoints_[event.contactPointsStart_].normal_;
+    contactEvents_.Push(event);
+}
+
+void Urho3DPhysX::PhysXScene::ExtractContactPoints(const PxContactPair & pair, PhysXContactEvent & event)
+{
+    extractedContacts_.Resize(pair.contactCount);
+    unsigned numPoints = pair.extractContacts(&extractedContacts_[0], pair.contactCount);
+    unsigned start = contactPoints_.Size();
+    contactPoints_.Resize(start + numPoints);
+    for (unsigned i = 0; i < numPoints; ++i)
+    {
+        const PxContactPairPoint& src = extractedContacts_[i];
+        PhysXContactPoint& dest = contactPoints_[start + i];
+        dest.position_ = ToVector3(src.position);
+        dest.normal_ = ToVector3(src.normal);
+        dest.separation_ = src.separation;
+        dest.impulse_ = ToVector3(src.impulse);
+        event.impulse_ += dest.impulse_;
+    }
+    event.numContactPoints_ += numPoints;
 }
 
 void Urho3DPhysX::PhysXScene::AddTriggerEvents(PxTriggerPair* pairs, unsigned numPairs)
 {
-    triggers_.Reserve(numPairs);
+    contactEvents_.Reserve(contactEvents_.Size() + numPairs);
     for (unsigned i = 0; i < numPairs; i++)
     {
-        TriggerData data;
         const PxTriggerPair& pair = pairs[i];
+        PhysXContactEvent event;
+        if (pair.status & PxPairFlag::eNOTIFY_TOUCH_FOUND)
+            ResetContactEvent(event, TRIGGER_ENTER);
+        else if (pair.status & PxPairFlag::eNOTIFY_TOUCH_LOST)
+            ResetContactEvent(event, TRIGGER_LEAVE);
+        else
+            continue;
         bool triggerRemoved = pair.flags & PxTriggerPairFlag::eREMOVED_SHAPE_TRIGGER;
         bool otherRemoved = pair.flags & PxTriggerPairFlag::eREMOVED_SHAPE_OTHER;
-        data.trigger_ = triggerRemoved ? nullptr : static_cast<CollisionShape*>(pair.triggerShape->userData);
-        data.triggerActor_ = triggerRemoved ? nullptr : static_cast<RigidActor*>(pair.triggerActor->userData);
-        data.otherShape_ = otherRemoved ? nullptr : static_cast<CollisionShape*>(pair.otherShape->userData);
-        data.otherActor_ = otherRemoved ? nullptr : static_cast<RigidActor*>(pair.otherActor->userData);
+        if (!triggerRemoved)
+        {
+            event.shape_ = GetCollisionShape(pair.triggerShape, pair.triggerActor);
+            event.actor_ = static_cast<RigidActor*>(pair.triggerActor->userData);
+        }
         //TODO: check if only shape was removed and actor still exists
-        if (!otherRemoved && !data.otherActor_)
+        if (!otherRemoved)
         {
-            PxShape* shape = pair.otherShape;
-            if (shape && shape->getSimulationFilterData().word2 == 1)
-            {
-                data.isControllerTrigger_ = true;
-                data.controller_ = WeakPtr<KinematicController>(static_cast<KinematicController*>(shape->userData));
-            }
+            SetContactEventShape(pair.otherShape, pair.otherActor, event.otherShape_, event.controller_);
+            event.otherActor_ = static_cast<RigidActor*>(pair.otherActor->userData);
         }
-        if (pair.status & PxPairFlag::eNOTIFY_TOUCH_FOUND)
-            data.eventType_ = E_TRIGGERENTER;
-        else if (pair.status & PxPairFlag::eNOTIFY_TOUCH_LOST)
-            data.eventType_ = E_TRIGGERLEAVE;
-        triggers_.Push(data);
+        contactEvents_.Push(event);
+    }
+}
+
+void Urho3DPhysX::PhysXScene::AddContactListener(PhysXContactListener * listener)
+{
+    if (listener && !contactListeners_.Contains(listener))
+        contactListeners_.Push(listener);
+}
+
+void Urho3DPhysX::PhysXScene::RemoveContactListener(PhysXContactListener * listener)
+{
+    contactListeners_.Remove(listener);
+}
+
+void Urho3DPhysX::PhysXScene::RemoveFromContactEvents(Object * object)
+{
+    if (!object)
+        return;
+    for (auto& event : contactEvents_)
+    {
+        //shape always belongs to actor on the same side of the event
+        if (event.actor_ == object)
+        {
+            event.actor_ = nullptr;
+            event.shape_ = nullptr;
+        }
+        if (event.otherActor_ == object)
+        {
+            event.otherActor_ = nullptr;
+            event.otherShape_ = nullptr;
+        }
+        if (event.shape_ == object)
+            event.shape_ = nullptr;
+        if (event.otherShape_ == object)
+            event.otherShape_ = nullptr;
+        if (event.controller_ == object)
+            event.controller_ = nullptr;
     }
 }
 
@@ -385,6 +1302,7 @@ void Urho3DPhysX::PhysXScene::SetProcessSimulationEvents(bool process)
         processSimEvents_ = process;
         if (pxScene_)
         {
+            FetchResults();
             if (process)
                 pxScene_->setSimulationEventCallback(&simulationEventCallback_);
             else
@@ -393,6 +1311,18 @@ void Urho3DPhysX::PhysXScene::SetProcessSimulationEvents(bool process)
     }
 }
 
+void Urho3DPhysX::PhysXScene::SetContactModifier(PhysXContactModifier * modifier)
+{
+    if (modifier != contactModifyCallback_.GetModifier())
+    {
+        //callback can't be changed while simulating
+        FetchResults();
+        contactModifyCallback_.SetModifier(modifier);
+        if (pxScene_)
+            pxScene_->setContactModifyCallback(modifier ? &contactModifyCallback_ : nullptr);
+    }
+}
+
 void Urho3DPhysX::PhysXScene::HandleSceneSubsystemUpdate(StringHash eventType, VariantMap & eventData)
 {
     if (!enabled_)
@@ -400,6 +1330,12 @@ void Urho3DPhysX::PhysXScene::HandleSceneSubsystemUpdate(StringHash eventType, V
     Update(eventData[SceneSubsystemUpdate::P_TIMESTEP].GetFloat());
 }
 
+void Urho3DPhysX::PhysXScene::HandleBeginFrame(StringHash eventType, VariantMap & eventData)
+{
+    //collect step started at the end of previous frame
+    FetchResults();
+}
+
 void Urho3DPhysX::PhysXScene::OnSceneSet(Scene * scene)
 {
     if (scene)
@@ -472,6 +1408,8 @@ void Urho3DPhysX::PhysXScene::OnSceneSet(Scene * scene)
         if(processSimEvents_)
             descr.simulationEventCallback = &simulationEventCallback_;
         descr.broadPhaseCallback = &broadPhaseCallback_;
+        if (contactModifyCallback_.GetModifier())
+            descr.contactModifyCallback = &contactModifyCallback_;
         descr.broadPhaseType = broadPhaseType;
         descr.filterShader = physxSceneFilterShader;
 
@@ -490,126 +1428,111 @@ void Urho3DPhysX::PhysXScene::OnSceneSet(Scene * scene)
         controllerManager_->setOverlapRecoveryModule(true);
 
         SubscribeToEvent(scene, E_SCENESUBSYSTEMUPDATE, URHO3D_HANDLER(PhysXScene, HandleSceneSubsystemUpdate));
+        SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(PhysXScene, HandleBeginFrame));
         //SubscribeToEvent(E_POSTRENDERUPDATE, URHO3D_HANDLER(PhysXScene, HandlePostRenderUpdate));
     }
 }
 
-void Urho3DPhysX::PhysXScene::ProcessTriggers()
+void Urho3DPhysX::PhysXScene::ProcessContactEvents()
 {
-    URHO3D_PROFILE(ProcessTriggers);
-    using namespace TriggerEnter;
-    if (triggers_.Size())
+    URHO3D_PROFILE(ProcessContactEvents);
+    if (contactEvents_.Empty())
+        return;
+    for (unsigned i = 0; i < contactListeners_.Size(); ++i)
+        contactListeners_[i]->OnContactEvents(this, contactEvents_);
+    //event handlers may remove actors, so entries are read again after every sent event
+    for (unsigned i = 0; i < contactEvents_.Size(); ++i)
     {
-        for (auto& data : triggers_)
+        const PhysXContactEvent& event = contactEvents_[i];
+        switch (event.type_)
         {
-            triggersDataMap_[P_PHYSX_SCENE] = this;
-            WeakPtr<CollisionShape> triggerShape = data.trigger_;
-            triggersDataMap_[P_SHAPE] = triggerShape;
-            triggersDataMap_[P_ACTOR] = data.triggerActor_;
-            WeakPtr<CollisionShape> otherShape = data.otherShape_;
-            triggersDataMap_[P_OTHERSHAPE] = otherShape;
-            triggersDataMap_[P_OTHERACTOR] = data.otherActor_;
-            triggersDataMap_[P_CONRTOLLERCOLLISION] = data.isControllerTrigger_;
-            triggersDataMap_[P_CONTROLLER] = data.controller_;
-            if (triggerShape)
-                triggerShape->SendEvent(data.eventType_, triggersDataMap_);
-            /*if (otherShape)
-                otherShape->SendEvent(data.eventType_, triggersDataMap_);*/
-            else
-                SendEvent(data.eventType_, triggersDataMap_);
+        case CONTACT_START:
+            SendCollisionEvent(event.actor_, event.otherActor_, event.controller_, E_COLLISIONSTART);
+            //collision start is also a normal collision
+            SendCollisionEvent(event.actor_, event.otherActor_, event.controller_, E_COLLISION);
+            SendCollisionEvent(event.otherActor_, event.actor_, event.controller_, E_COLLISIONSTART);
+            SendCollisionEvent(event.otherActor_, event.actor_, event.controller_, E_COLLISION);
+            break;
+        case CONTACT_PERSIST:
+            SendCollisionEvent(event.actor_, event.otherActor_, event.controller_, E_COLLISION);
+            SendCollisionEvent(event.otherActor_, event.actor_, event.controller_, E_COLLISION);
+            break;
+        case CONTACT_END:
+            SendCollisionEvent(event.actor_, event.otherActor_, event.controller_, E_COLLISIONEND);
+            SendCollisionEvent(event.otherActor_, event.actor_, event.controller_, E_COLLISIONEND);
+            break;
+        case CONTACT_FORCE_THRESHOLD:
+            //only for contact listeners
+            break;
+        case TRIGGER_ENTER:
+        case TRIGGER_LEAVE:
+        {
+            using namespace TriggerEnter;
+            StringHash eventType = event.type_ == TRIGGER_ENTER ? E_TRIGGERENTER : E_TRIGGERLEAVE;
+            Object* sender = event.shape_ ? static_cast<Object*>(event.shape_) : this;
+            if (HasEventReceivers(sender, eventType))
+            {
+                triggersDataMap_[P_PHYSX_SCENE] = this;
+                triggersDataMap_[P_SHAPE] = event.shape_;
+                triggersDataMap_[P_ACTOR] = event.actor_;
+                triggersDataMap_[P_OTHERSHAPE] = event.otherShape_;
+                triggersDataMap_[P_OTHERACTOR] = event.otherActor_;
+                triggersDataMap_[P_CONRTOLLERCOLLISION] = event.controller_ != nullptr;
+                triggersDataMap_[P_CONTROLLER] = event.controller_;
+                sender->SendEvent(eventType, triggersDataMap_);
+            }
+            break;
+        }
         }
-        triggers_.Clear();
     }
 }
 
-void Urho3DPhysX::PhysXScene::ProcessCollisions()
+void Urho3DPhysX::PhysXScene::SendCollisionEvent(RigidActor * actor, RigidActor * otherActor, KinematicController * controller, StringHash eventType)
 {
-    URHO3D_PROFILE(ProcessCollisions);
     using namespace Collision;
-    if (collisions_.Size())
-    {
-        for (auto& data : collisions_)
-        {
-            WeakPtr<RigidActor> actorA = data.actorA_;
-            WeakPtr<RigidActor> actorB = data.actorB_;
-            collisionDataMap_[P_PHYSX_SCENE] = this;
-            collisionDataMap_[P_CONTROLLER] = WeakPtr<KinematicController>(data.controller_);
-            collisionDataMap_[P_CONTROLLERCOLLISION] = data.isControllerCollision_;
-            if(actorA)
-            {
-                collisionDataMap_[P_ACTOR] = actorA;
-                collisionDataMap_[P_OTHERACTOR] = actorB ? actorB : nullptr;
-                actorA->SendEvent(data.eventType_, collisionDataMap_);
-                //if event is collision start, send also normal collision
-                if (data.eventType_ == E_COLLISIONSTART)
-                    actorA->SendEvent(E_COLLISION, collisionDataMap_);
-            }
-            if(actorB)
-            {
-                collisionDataMap_[P_ACTOR] = actorB;
-                collisionDataMap_[P_OTHERACTOR] = actorA ? actorA : nullptr;
-                actorB->SendEvent(data.eventType_, collisionDataMap_);
-                //if event is collision start, send also normal collision
-                if (data.eventType_ == E_COLLISIONSTART)
-                    actorB->SendEvent(E_COLLISION, collisionDataMap_);
-            }
-        }
-        collisions_.Clear();
-    }
+    if (!actor || !HasEventReceivers(actor, eventType))
+        return;
+    collisionDataMap_[P_PHYSX_SCENE] = this;
+    collisionDataMap_[P_ACTOR] = actor;
+    collisionDataMap_[P_OTHERACTOR] = otherActor;
+    collisionDataMap_[P_CONTROLLER] = controller;
+    collisionDataMap_[P_CONTROLLERCOLLISION] = controller != nullptr;
+    actor->SendEvent(eventType, collisionDataMap_);
 }
 
-bool Urho3DPhysX::PhysXScene::Sweep(PODVector<PhysXRaycastResult>& results, const Ray & ray, const Quaternion & rotation, const PxGeometry & geometry, float maxDistance, unsigned mask)
+bool Urho3DPhysX::PhysXScene::HasEventReceivers(Object * sender, StringHash eventType)
+{
+    EventReceiverGroup* group = context_->GetEventReceivers(sender, eventType);
+    if (group && !group->receivers_.Empty())
+        return true;
+    group = context_->GetEventReceivers(eventType);
+    return group && !group->receivers_.Empty();
+}
+
+bool Urho3DPhysX::PhysXScene::Sweep(PODVector<PhysXRaycastResult>& results, const Ray & ray, const Quaternion & rotation, const PxGeometry & geometry, float maxDistance, unsigned mask, const PhysXQueryOptions& options)
 {
     URHO3D_PROFILE(PhysXSweep);
+    StreamingHitCallback<PxSweepHit, PhysXRaycastResult> callback(results, options.maxHits_, options.sortByDistance_);
     if (pxScene_)
     {
-        PxSweepBufferN<MAX_RAYCAST_HITS> buffer;
-        PxQueryFilterData filter;
-        filter.data.word0 = mask;
-        if (pxScene_->sweep(geometry, ToPxTransform(ray.origin_, rotation), ToPxVec3(ray.direction_), maxDistance, buffer, DEF_RAYCAST_FLAGS, filter))
-        {
-            unsigned numHits = buffer.getNbAnyHits();
-            if (numHits)
-            {
-                results.Clear();
-                results.Reserve(numHits);
-                for (unsigned i = 0; i < numHits; ++i)
-                {
-                    const PxSweepHit& hit = buffer.getAnyHit(i);
-                    PhysXRaycastResult result;
-                    result.actor_ = static_cast<RigidActor*>(hit.actor->userData);
-                    result.shape_ = static_cast<CollisionShape*>(hit.shape->userData);
-                    result.distance_ = hit.distance;
-                    result.normal_ = ToVector3(hit.normal);
-                    result.position_ = ToVector3(hit.position);
-                    results.Push(result);
-                }
-                Sort(results.Begin(), results.End(), ComparePhysXRaycastResults);
-                return true;
-            }
-        }
+        pxScene_->sweep(geometry, ToPxTransform(ray.origin_, rotation), ToPxVec3(ray.direction_), maxDistance, callback, options.hitFlags_, GetQueryFilterData(mask, options, true));
+        if (options.sortByDistance_)
+            Sort(results.Begin(), results.End(), CompareRaycastResults);
     }
-    return false;
+    return !results.Empty();
 }
 
-bool Urho3DPhysX::PhysXScene::SweepSingle(PhysXRaycastResult & result, const Ray & ray, const Quaternion& rotation, const PxGeometry & geometry, float maxDistance, unsigned mask)
+bool Urho3DPhysX::PhysXScene::SweepSingle(PhysXRaycastResult & result, const Ray & ray, const Quaternion& rotation, const PxGeometry & geometry, float maxDistance, unsigned mask, const PhysXQueryOptions& options)
 {
     URHO3D_PROFILE(PhysXSweepSingle);
     if (pxScene_)
     {
         PxSweepBuffer buffer;
-        PxQueryFilterData filter;
-        filter.data.word0 = mask;
-        if (pxScene_->sweep(geometry, ToPxTransform(ray.origin_, rotation), ToPxVec3(ray.direction_), maxDistance, buffer, DEF_RAYCAST_FLAGS, filter))
+        if (pxScene_->sweep(geometry, ToPxTransform(ray.origin_, rotation), ToPxVec3(ray.direction_), maxDistance, buffer, options.hitFlags_, GetQueryFilterData(mask, options, false)))
         {
             if (buffer.hasBlock)
             {
-                const PxSweepHit& block = buffer.block;
-                result.actor_ = static_cast<RigidActor*>(block.actor->userData);
-                result.shape_ = static_cast<CollisionShape*>(block.shape->userData);
-                result.distance_ = block.distance;
-                result.normal_ = ToVector3(block.normal);
-                result.position_ = ToVector3(block.position);
+                SetQueryResult(result, buffer.block);
                 return true;
             }
         }
@@ -617,21 +1540,109 @@ bool Urho3DPhysX::PhysXScene::SweepSingle(PhysXRaycastResult & result, const Ray
     return false;
 }
 
+bool Urho3DPhysX::PhysXScene::Overlap(PODVector<PhysXOverlapResult>& results, const PxGeometry & geometry, const PxTransform & pose, unsigned mask, const PhysXQueryOptions& options, const PxRigidActor * ignoredActor)
+{
+    URHO3D_PROFILE(PhysXOverlap);
+    StreamingHitCallback<PxOverlapHit, PhysXOverlapResult> callback(results, options.maxHits_, false);
+    if (pxScene_)
+    {
+        //overlaps don't have closest hit, report everything as touch
+        PxQueryFilterData filter = GetQueryFilterData(mask, options, true);
+        IgnoreActorQueryFilter ignoreFilter(ignoredActor);
+        if (ignoredActor)
+            filter.flags |= PxQueryFlag::ePREFILTER;
+        pxScene_->overlap(geometry, pose, callback, filter, ignoredActor ? &ignoreFilter : nullptr);
+    }
+    return !results.Empty();
+}
+
+bool Urho3DPhysX::PhysXScene::OverlapAny(const PxGeometry & geometry, const PxTransform & pose, unsigned mask, const PhysXQueryOptions& options, const PxRigidActor * ignoredActor)
+{
+    URHO3D_PROFILE(PhysXOverlapAny);
+    if (pxScene_)
+    {
+        PxOverlapBuffer buffer;
+        PxQueryFilterData filter = GetQueryFilterData(mask, options, false);
+        filter.flags |= PxQueryFlag::eANY_HIT;
+        IgnoreActorQueryFilter ignoreFilter(ignoredActor);
+        if (ignoredActor)
+            filter.flags |= PxQueryFlag::ePREFILTER;
+        return pxScene_->overlap(geometry, pose, buffer, filter, ignoredActor ? &ignoreFilter : nullptr) && buffer.hasBlock;
+    }
+    return false;
+}
+
+bool Urho3DPhysX::PhysXScene::GetShapeQueryGeometry(CollisionShape * shape, PxGeometryHolder & geometry, PxTransform & pose)
+{
+    if (!shape || !shape->GetShape() || !shape->GetRigidActor() || !shape->GetRigidActor()->GetActor())
+        return false;
+    PxShape* pxShape = shape->GetShape();
+    geometry = pxShape->getGeometry();
+    switch (geometry.getType())
+    {
+    case PxGeometryType::eSPHERE:
+    case PxGeometryType::eBOX:
+    case PxGeometryType::eCAPSULE:
+    case PxGeometryType::eCONVEXMESH:
+        pose = PxShapeExt::getGlobalPose(*pxShape, *shape->GetRigidActor()->GetActor());
+        return true;
+    default:
+        URHO3D_LOGWARNING("Overlap queries support only box, sphere, capsule and convex mesh shapes.");
+        return false;
+    }
+}
+
 void Urho3DPhysX::PhysXScene::ReleaseScene()
 {
     //may lead to assertion failure in pxScene->realease() when using GPU dynamics!
     if (pxScene_)
     {
         UnsubscribeFromEvent(E_SCENESUBSYSTEMUPDATE);
-        collisions_.Clear();
-        triggers_.Clear();
-        for (auto* a : rigidActors_)
-            a->RemoveFromScene();
+        UnsubscribeFromEvent(E_BEGINFRAME);
+        if (isSimulating_)
+            pxScene_->fetchResults(true);
+        isSimulating_ = false;
+        resultsPending_ = false;
+        RemoveAllActors();
         pxScene_->release();
         pxScene_ = nullptr;
     }
 }
 
+void Urho3DPhysX::PhysXScene::RemoveAllActors()
+{
+    URHO3D_PROFILE(PhysXRemoveAllActors);
+    PODVector<PxActor*> pxActors;
+    pxActors.Reserve(rigidActors_.Size());
+    for (auto* actor : rigidActors_)
+    {
+        if (actor->GetActor() && actor->pendingIndex_ == M_MAX_UNSIGNED)
+            pxActors.Push(actor->GetActor());
+        actor->pendingIndex_ = M_MAX_UNSIGNED;
+        actor->massDirtyIndex_ = M_MAX_UNSIGNED;
+        actor->sceneIndex_ = M_MAX_UNSIGNED;
+        actor->transformDirtyIndex_ = M_MAX_UNSIGNED;
+        actor->interpolationIndex_ = M_MAX_UNSIGNED;
+        actor->pxScene_.Reset();
+    }
+    //single call instead of removing actors one by one
+    if (!pxActors.Empty())
+        pxScene_->removeActors(&pxActors[0], pxActors.Size());
+    for (unsigned i = 0; i < dirtyShapes_.Size(); ++i)
+    {
+        if (dirtyShapes_[i])
+            dirtyShapes_[i]->shapeQueued_ = false;
+    }
+    dirtyShapes_.Clear();
+    rigidActors_.Clear();
+    pendingActors_.Clear();
+    dirtyMasses_.Clear();
+    dirtyTransforms_.Clear();
+    interpolatedActors_.Clear();
+    contactEvents_.Clear();
+    contactPoints_.Clear();
+}
+
 void Urho3DPhysX::PhysXScene::HandlePostRenderUpdate(StringHash eventType, VariantMap & eventData)
 {
     Scene* s = node_->GetScene();
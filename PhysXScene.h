@@ -2,7 +2,15 @@
 #include "PhysXEvents.h"
 #include <Urho3D/Scene/Component.h>
 #include <Urho3D/Math/Ray.h>
+#include <Urho3D/Core/Timer.h>
 #include <PxScene.h>
+#include <geometry/PxGeometryHelpers.h>
+#include <extensions/PxMassProperties.h>
+
+namespace Urho3D
+{
+    struct WorkItem;
+}
 
 namespace physx
 {
@@ -18,51 +26,122 @@ namespace Urho3DPhysX
     class CollisionShape;
     class Joint;
 
-    struct CollisionData
+    enum URHOPX_API PhysXSteppingMode
     {
-        CollisionData() :
-            actorA_(nullptr),
-            actorB_(nullptr),
-            controller_(nullptr),
-            isControllerCollision_(false),
-            eventType_(E_COLLISION)
-        {
-        }
-        WeakPtr<RigidActor> actorA_;
-        WeakPtr<RigidActor> actorB_;
-        WeakPtr<KinematicController> controller_;
-        bool isControllerCollision_;
-        StringHash eventType_;
+        ///simulate and fetch results in scene subsystem update
+        SYNCHRONOUS_STEPPING = 0,
+        ///start last substep at the end of scene subsystem update and fetch results at the beginning of next frame
+        OVERLAPPED_STEPPING,
+        ///send E_PX_PRESIMULATION, start collision detection (collide) and send E_PX_COLLIDING while it runs, then send E_PX_POSTCOLLIDE and run solver (advance) with changes made by post collide handlers
+        SPLIT_STEPPING
     };
 
-    struct TriggerData
+    enum URHOPX_API PhysXContactEventType
     {
-        TriggerData() :
-            trigger_(nullptr),
-            triggerActor_(nullptr),
-            otherShape_(nullptr),
-            otherActor_(nullptr),
-            isControllerTrigger_(false),
-            controller_(nullptr)
-        {
+        CONTACT_START = 0,
+        CONTACT_PERSIST,
+        CONTACT_END,
+        TRIGGER_ENTER,
+        TRIGGER_LEAVE,
+        ///contact force exceeded threshold of dynamic body (CR_FORCE_THRESHOLD), not sent as Urho event
+        CONTACT_FORCE_THRESHOLD
+    };
 
-        }
-        WeakPtr<CollisionShape> trigger_;
-        WeakPtr<RigidActor> triggerActor_;
-        WeakPtr<CollisionShape> otherShape_;
-        WeakPtr<RigidActor> otherActor_;
-        bool isControllerTrigger_;
-        WeakPtr<KinematicController> controller_;
-        StringHash eventType_;
+    ///Contact point extracted for pairs with CR_CONTACT_POINTS
+    struct URHOPX_API PhysXContactPoint
+    {
+        Vector3 position_;
+        ///from other shape to shape
+        Vector3 normal_;
+        ///negative when shapes are penetrating
+        float separation_;
+        ///impulse applied at this point
+        Vector3 impulse_;
+    };
+
+    ///Contact or trigger event of last simulation step. Pointers are reset to null when actor, shape or controller is removed, so they are safe to use until results of the next step are fetched.
+    struct URHOPX_API PhysXContactEvent
+    {
+        PhysXContactEventType type_;
+        ///for triggers - actor of trigger shape
+        RigidActor* actor_;
+        ///for triggers - trigger shape, for contacts - first shape of actor_ in contact
+        CollisionShape* shape_;
+        RigidActor* otherActor_;
+        CollisionShape* otherShape_;
+        ///set when one side of contact or other side of trigger is kinematic controller
+        KinematicController* controller_;
+        ///contact normal (from otherActor_ to actor_), zero if contact points weren't reported for the pair
+        Vector3 normal_;
+        ///total impulse applied to actor_, zero if contact points weren't reported for the pair
+        Vector3 impulse_;
+        ///index of first contact point in PhysXScene::GetContactPoints
+        unsigned contactPointsStart_;
+        ///
+        unsigned numContactPoints_;
+    };
+
+    ///Receives contact and trigger events without going through Urho events
+    class URHOPX_API PhysXContactListener
+    {
+    public:
+        virtual ~PhysXContactListener() {}
+        ///Called on main thread after simulation results are applied. Removing scene objects here is safe, their events are reset
+        virtual void OnContactEvents(PhysXScene* scene, const PODVector<PhysXContactEvent>& events) = 0;
+    };
+
+    ///Modifies contacts of pairs with CR_MODIFY_CONTACTS before they are passed to solver (one-way platforms, conveyor belts, friction, restitution or max impulse overrides).
+    ///Called from PhysX worker threads, possibly on several threads at once with different pairs, so it must not access the scene or Urho objects that aren't thread safe.
+    class URHOPX_API PhysXContactModifier
+    {
+    public:
+        virtual ~PhysXContactModifier() {}
+        ///Shape user data is CollisionShape (or KinematicController for controller shapes), null for shared shapes: use RigidActor from actor user data and RigidActor::GetCollisionShape
+        virtual void OnModifyContacts(PxContactModifyPair* pairs, unsigned count) = 0;
     };
 
     struct URHOPX_API PhysXRaycastResult
     {
         RigidActor* actor_;
         CollisionShape* shape_;
+        ///zero if position wasn't requested in query options
         Vector3 position_;
+        ///zero if normal wasn't requested in query options
         Vector3 normal_;
         float distance_;
+        ///index of hit triangle of mesh shape, set only when requested in query options (PxHitFlag::eFACE_INDEX)
+        unsigned faceIndex_;
+    };
+
+    struct URHOPX_API PhysXQueryOptions
+    {
+        PhysXQueryOptions() :
+            hitFlags_(PxHitFlag::ePOSITION | PxHitFlag::eNORMAL),
+            anyHit_(false),
+            queryStatic_(true),
+            queryDynamic_(true),
+            maxHits_(0),
+            sortByDistance_(true)
+        {
+        }
+        ///Hit data to compute. Skip ePOSITION/eNORMAL when only hit actor or distance is needed, add eFACE_INDEX for mesh triangle index, eMESH_MULTIPLE/eMESH_BOTH_SIDES for mesh hits
+        PxHitFlags hitFlags_;
+        ///Stop at first found hit, it doesn't have to be the closest one (for visibility checks)
+        bool anyHit_;
+        ///Test static actors
+        bool queryStatic_;
+        ///Test dynamic actors
+        bool queryDynamic_;
+        ///Max number of hits returned by multiple hits queries, 0 - unlimited. Sorted queries keep maxHits closest hits, unsorted stop after maxHits hits
+        unsigned maxHits_;
+        ///Sort hits of multiple hits queries by distance
+        bool sortByDistance_;
+    };
+
+    struct URHOPX_API PhysXOverlapResult
+    {
+        RigidActor* actor_;
+        CollisionShape* shape_;
     };
 
     class URHOPX_API DefCtrlFilterCallback : public PxControllerFilterCallback
@@ -76,6 +155,59 @@ namespace Urho3DPhysX
         URHO3D_OBJECT(PhysXScene, Component);
         friend class SimulationEventCallback;
     public:
+        ///Batch of closest-hit raycasts and sweeps executed together, split across WorkQueue threads. Reuse the batch between frames to avoid allocations.
+        class URHOPX_API QueryBatch
+        {
+        public:
+            QueryBatch(PhysXScene* scene);
+            ///Remove all queries, keeps allocated memory
+            void Clear() { queries_.Clear(); }
+            ///
+            void AddRaycast(const Ray& ray, float maxDistance, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
+            ///
+            void AddSphereCast(const Ray& ray, float radius, float maxDistance, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
+            ///
+            void AddBoxCast(const Ray& ray, const Vector3& size, const Quaternion& rotation, float maxDistance, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
+            ///
+            void AddCapsuleCast(const Ray& ray, float radius, float height, const Quaternion& rotation, float maxDistance, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
+            ///
+            unsigned GetNumQueries() const { return queries_.Size(); }
+            ///Set min number of queries per work item, smaller batches are executed on calling thread
+            void SetMinQueriesPerThread(unsigned num) { minQueriesPerThread_ = Max(num, 1U); }
+            ///
+            unsigned GetMinQueriesPerThread() const { return minQueriesPerThread_; }
+            ///Execute queries, results must hold GetNumQueries() elements. Result of query without hit has null actor and shape and infinite distance. Returns number of queries that hit something.
+            unsigned Execute(PhysXRaycastResult* results);
+            ///Execute queries, results are resized to GetNumQueries()
+            unsigned Execute(PODVector<PhysXRaycastResult>& results);
+
+        private:
+            struct Query
+            {
+                Ray ray_;
+                Quaternion rotation_;
+                PxGeometryHolder geometry_;
+                float maxDistance_;
+                unsigned mask_;
+                PxHitFlags hitFlags_;
+                PxQueryFlags queryFlags_;
+                bool isSweep_;
+            };
+            ///
+            void AddSweep(const Ray& ray, const Quaternion& rotation, const PxGeometry& geometry, float maxDistance, unsigned mask, const PhysXQueryOptions& options);
+            ///
+            void ExecuteRange(unsigned start, unsigned end);
+            ///
+            static void ExecuteRangeWork(const WorkItem* item, unsigned threadIndex);
+
+            WeakPtr<PhysXScene> scene_;
+            PODVector<Query> queries_;
+            PhysXRaycastResult* results_;
+            ///hit PxShape of each query, owners of shared shapes are resolved on main thread after workers complete
+            PODVector<const PxShape*> hitShapes_;
+            unsigned minQueriesPerThread_;
+        };
+
         PhysXScene(Context* context);
         ~PhysXScene();
 
@@ -88,22 +220,38 @@ namespace Urho3DPhysX
         void AddActor(RigidActor* actor);
         ///Remove actor from scene, this will NOT reset scene pointer in actor - use RigidActor::RemoveFromScene instead.
         void RemoveActor(RigidActor* actor);
+        ///Get all hits along the ray. Results buffer is reused
+        bool Raycast(PODVector<PhysXRaycastResult>& results, const Ray& ray, float maxDistance, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
         ///
-        bool Raycast(PODVector<PhysXRaycastResult>& results, const Ray& ray, float maxDistance, unsigned mask);
+        bool RaycastSingle(PhysXRaycastResult& result, const Ray& ray, float maxDistance, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
         ///
-        bool RaycastSingle(PhysXRaycastResult& result, const Ray& ray, float maxDistance, unsigned mask);
+        bool SphereCast(PODVector<PhysXRaycastResult>& results, const Ray& ray, float radius, float maxDistance, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
         ///
-        bool SphereCast(PODVector<PhysXRaycastResult>& results, const Ray& ray, float radius, float maxDistance, unsigned mask);
+        bool SphereCastSingle(PhysXRaycastResult& result, const Ray& ray, float radius, float maxDistance, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
         ///
-        bool SphereCastSingle(PhysXRaycastResult& result, const Ray& ray, float radius, float maxDistance, unsigned mask);
+        bool BoxCast(PODVector<PhysXRaycastResult>& results, const Ray& ray, const Vector3& size, const Quaternion& rotation, float maxDistance, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
         ///
-        bool BoxCast(PODVector<PhysXRaycastResult>& results, const Ray& ray, const Vector3& size, const Quaternion& rotation, float maxDistance, unsigned mask);
+        bool BoxCastSingle(PhysXRaycastResult& result, const Ray& ray, const Vector3& size, const Quaternion& rotation, float maxDistance, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
         ///
-        bool BoxCastSingle(PhysXRaycastResult& result, const Ray& ray, const Vector3& size, const Quaternion& rotation, float maxDistance, unsigned mask);
+        bool CapsuleCast(PODVector<PhysXRaycastResult>& results, const Ray& ray, float radius, float height, const Quaternion& rotation, float maxDistance, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
         ///
-        bool CapsuleCast(PODVector<PhysXRaycastResult>& results, const Ray& ray, float radius, float height, const Quaternion& rotation, float maxDistance, unsigned mask);
-        ///
-        bool CapsuleCastSingle(PhysXRaycastResult& result, const Ray& ray, float radius, float height, const Quaternion& rotation, float maxDistance, unsigned mask);
+        bool CapsuleCastSingle(PhysXRaycastResult& result, const Ray& ray, float radius, float height, const Quaternion& rotation, float maxDistance, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
+        ///Get all shapes overlapping sphere
+        bool OverlapSphere(PODVector<PhysXOverlapResult>& results, const Vector3& center, float radius, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
+        ///Check if anything overlaps sphere, stops at first found shape
+        bool OverlapSphereAny(const Vector3& center, float radius, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
+        ///Get all shapes overlapping box
+        bool OverlapBox(PODVector<PhysXOverlapResult>& results, const Vector3& center, const Vector3& size, const Quaternion& rotation, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
+        ///Check if anything overlaps box, stops at first found shape
+        bool OverlapBoxAny(const Vector3& center, const Vector3& size, const Quaternion& rotation, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
+        ///Get all shapes overlapping capsule
+        bool OverlapCapsule(PODVector<PhysXOverlapResult>& results, const Vector3& center, float radius, float height, const Quaternion& rotation, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
+        ///Check if anything overlaps capsule, stops at first found shape
+        bool OverlapCapsuleAny(const Vector3& center, float radius, float height, const Quaternion& rotation, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
+        ///Get all shapes overlapping collision shape (box, sphere, capsule or convex mesh attached to actor), shapes of the same actor are ignored
+        bool OverlapShape(PODVector<PhysXOverlapResult>& results, CollisionShape* shape, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
+        ///Check if anything overlaps collision shape, stops at first found shape
+        bool OverlapShapeAny(CollisionShape* shape, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
         ///
         void SetDebugDrawEnabled(bool enable);
         ///
@@ -120,8 +268,26 @@ namespace Urho3DPhysX
         void SetMaxSubsteps(int value) { maxSubsteps_ = value; }
         ///
         int GetMaxSubsteps() const { return maxSubsteps_; }
-        ///
+        ///Check if simulation step is running (in overlapped stepping mode this is true between end of scene update and beginning of next frame)
         bool IsSimulating() const { return isSimulating_; }
+        ///Set stepping mode. Switching mode completes running step
+        void SetSteppingMode(PhysXSteppingMode mode);
+        ///
+        PhysXSteppingMode GetSteppingMode() const { return steppingMode_; }
+        ///Queue added actors and insert them in one batch at next scene update (or FlushPendingActors call). Actors added while scene is loading asynchronously are always queued
+        void SetDeferredInsertion(bool enable);
+        ///
+        bool IsDeferredInsertion() const { return deferredInsertion_; }
+        ///Insert queued actors to PhysX scene, static actors are added with pruning structure built on worker thread
+        void FlushPendingActors();
+        ///
+        unsigned GetNumPendingActors() const { return pendingActors_.Size(); }
+        ///Set interpolation of node transforms between last two simulation steps, allows lower FPS without visible stutter. Nodes lag one step behind simulation
+        void SetInterpolation(bool enable);
+        ///
+        bool IsInterpolating() const { return interpolation_; }
+        ///Wait for running simulation step, apply results to nodes and send collision/trigger events. Does nothing if no step is running
+        void FetchResults();
         ///
         void SetProcessSimulationEvents(bool process);
         ///
@@ -134,44 +300,164 @@ namespace Urho3DPhysX
         ControllerHitCallback* GetControllerHitCallback() { return &controllerHitCallback_; }
         ///
         float GetFixedStep() const { return fixedStep_; }
+        ///Get time in milliseconds spent in simulate/fetchResults during last update
+        float GetLastStepTime() const { return lastStepTime_; }
+        ///Get smoothed time in milliseconds spent in simulate/fetchResults per update
+        float GetAverageStepTime() const { return averageStepTime_; }
+        ///Queue shape to have its geometry rebuilt before next simulation step
+        void MarkShapeDirty(CollisionShape* shape);
+        ///Rebuild geometry of queued shapes
+        void FlushDirtyShapes();
+        ///Queue actor to have its node transform applied before next simulation step
+        void MarkTransformDirty(RigidActor* actor);
+        ///Apply transforms of moved nodes to actors
+        void FlushDirtyTransforms();
+        ///Queue body to have mass and inertia recomputed before next simulation step
+        void MarkMassDirty(RigidBody* body);
+        ///Recompute mass and inertia of queued bodies, large batches are computed on worker threads
+        void FlushDirtyMasses();
+        ///Get number of nodes updated from active actors when last results were applied
+        unsigned GetNumSyncedNodes() const { return numSyncedNodes_; }
+        ///Get contact and trigger events of last fetched simulation results
+        const PODVector<PhysXContactEvent>& GetContactEvents() const { return contactEvents_; }
+        ///Get contact points of last fetched contact events, same lifetime as events
+        const PODVector<PhysXContactPoint>& GetContactPoints() const { return contactPoints_; }
+        ///
+        void AddContactListener(PhysXContactListener* listener);
+        ///
+        void RemoveContactListener(PhysXContactListener* listener);
+        ///Reset pointers to removed actor, shape or controller in contact events
+        void RemoveFromContactEvents(Object* object);
+        ///Set contact modifier, null disables contact modification. Modifier must outlive the scene or be removed first
+        void SetContactModifier(PhysXContactModifier* modifier);
+        ///
+        PhysXContactModifier* GetContactModifier() const { return contactModifyCallback_.GetModifier(); }
 
     private:
         void HandleSceneSubsystemUpdate(StringHash eventType, VariantMap& eventData);
+        ///
+        void HandleBeginFrame(StringHash eventType, VariantMap& eventData);
+        ///Send pre simulation event and start simulation step
+        void BeginStep(float timeStep);
+        ///
+        void SendStepEvent(StringHash eventType, float timeStep);
+        ///Wait for simulation step to complete, results are not applied
+        void EndStep();
+        ///Apply transforms of active actors and send simulation events
+        void ApplyResults();
+        ///Write poses of active actors to their nodes
+        void SyncActiveTransforms();
+        ///Update previous and target poses of active actors
+        void UpdateInterpolationTargets();
+        ///Write blended poses of interpolated actors to nodes
+        void InterpolateTransforms();
+        ///
+        void RemoveInterpolatedActor(RigidActor* actor);
+        ///Read poses of active actors in given range, may be called from worker threads
+        void ReadActiveTransforms(unsigned start, unsigned end);
+        ///
+        static void ReadActiveTransformsWork(const WorkItem* item, unsigned threadIndex);
         void OnSceneSet(Scene* scene) override;
         ///
         void AddCollision(const PxContactPairHeader & pairHeader, const PxContactPair * pairs, PxU32 nbPairs);
+        ///Copy contact points of pair to contact points pool
+        void ExtractContactPoints(const PxContactPair& pair, PhysXContactEvent& event);
         ///
         void AddTriggerEvents(PxTriggerPair* pair, unsigned numPairs);
+        ///Notify contact listeners and send Urho events to subscribed receivers
+        void ProcessContactEvents();
         ///
-        void ProcessTriggers();
+        void SendCollisionEvent(RigidActor* actor, RigidActor* otherActor, KinematicController* controller, StringHash eventType);
         ///
-        void ProcessCollisions();
+        bool HasEventReceivers(Object* sender, StringHash eventType);
         ///
-        bool Sweep(PODVector<PhysXRaycastResult>& results, const Ray& ray, const Quaternion& rotation, const PxGeometry& geometry, float maxDistance, unsigned mask);
+        bool Sweep(PODVector<PhysXRaycastResult>& results, const Ray& ray, const Quaternion& rotation, const PxGeometry& geometry, float maxDistance, unsigned mask, const PhysXQueryOptions& options);
         ///
-        bool SweepSingle(PhysXRaycastResult& result, const Ray& ray, const Quaternion& rotation, const PxGeometry& geometry, float maxDistance, unsigned mask);
+        bool SweepSingle(PhysXRaycastResult& result, const Ray& ray, const Quaternion& rotation, const PxGeometry& geometry, float maxDistance, unsigned mask, const PhysXQueryOptions& options = PhysXQueryOptions());
+        ///
+        bool Overlap(PODVector<PhysXOverlapResult>& results, const PxGeometry& geometry, const PxTransform& pose, unsigned mask, const PhysXQueryOptions& options, const PxRigidActor* ignoredActor = nullptr);
+        ///
+        bool OverlapAny(const PxGeometry& geometry, const PxTransform& pose, unsigned mask, const PhysXQueryOptions& options, const PxRigidActor* ignoredActor = nullptr);
+        ///Get geometry and world pose of shape usable as overlap query
+        bool GetShapeQueryGeometry(CollisionShape* shape, PxGeometryHolder& geometry, PxTransform& pose);
         ///
         void ReleaseScene();
+        ///
+        void ComputeMassUpdates(unsigned start, unsigned end);
+        ///
+        static void ComputeMassUpdatesWork(const WorkItem* item, unsigned threadIndex);
+        ///
+        static void BuildPruningStructureWork(const WorkItem* item, unsigned threadIndex);
+        ///Remove all registered actors from PhysX scene in one batch
+        void RemoveAllActors();
         //temp
         void HandlePostRenderUpdate(StringHash eventType, VariantMap& eventData);
+        struct MassUpdate
+        {
+            RigidBody* body_;
+            PxMassProperties properties_;
+            bool computed_;
+        };
+        struct ActiveTransform
+        {
+            RigidActor* actor_;
+            Vector3 position_;
+            Quaternion rotation_;
+        };
         PxScene* pxScene_;
         SimulationEventCallback simulationEventCallback_;
         BroadPhaseCallback broadPhaseCallback_;
+        ContactModifyCallback contactModifyCallback_;
         bool isSimulating_;
+        PhysXSteppingMode steppingMode_;
+        ///true when step results were fetched from PhysX but not applied yet
+        bool resultsPending_;
+        ///true between collide and advance in split stepping mode
+        bool isInCollisionPhase_;
+        long long stepTimeUSec_;
+        HiresTimer stepTimer_;
         float fps_;
         int maxSubsteps_;
         float timeAcc_;
         Vector3 gravity_;
         bool processSimEvents_;
-        Vector<CollisionData> collisions_;
-        Vector<TriggerData> triggers_;
+        PODVector<PhysXContactEvent> contactEvents_;
+        PODVector<PhysXContactPoint> contactPoints_;
+        ///reused buffer for PxContactPair::extractContacts
+        PODVector<PxContactPairPoint> extractedContacts_;
+        PODVector<PhysXContactListener*> contactListeners_;
         VariantMap triggersDataMap_;
         VariantMap collisionDataMap_;
         bool debugDrawEnabled_;
         PODVector<RigidActor*> rigidActors_;
+        ///shapes with changed geometry, shape may be removed while queued
+        Vector<WeakPtr<CollisionShape>> dirtyShapes_;
+        ///actors with moved nodes
+        PODVector<RigidActor*> dirtyTransforms_;
+        ///bodies waiting for mass and inertia update
+        PODVector<RigidBody*> dirtyMasses_;
+        PODVector<MassUpdate> massUpdates_;
+        bool deferredInsertion_;
+        ///actors waiting for insertion to PhysX scene
+        PODVector<RigidActor*> pendingActors_;
+        ///static actors of pending batch, used by pruning structure work item
+        PODVector<PxRigidActor*> pendingStatics_;
+        PxPruningStructure* pruningStructure_;
         PxControllerManager* controllerManager_;
         DefCtrlFilterCallback controllerFilterCallback_;
         ControllerHitCallback controllerHitCallback_;
         float fixedStep_;
+        float lastStepTime_;
+        float averageStepTime_;
+        ///poses of active actors converted to Urho types
+        PODVector<ActiveTransform> activeTransforms_;
+        ///valid only while active transforms are read
+        PxActor** activeActors_;
+        unsigned numSyncedNodes_;
+        bool interpolation_;
+        ///actors moved by recent steps, their nodes are updated every frame
+        PODVector<RigidActor*> interpolatedActors_;
+        ///number of applied results, used to find actors that stopped moving
+        unsigned interpolationStep_;
     };
 }
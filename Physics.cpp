@@ -12,6 +12,7 @@
 #include "RevoluteJoint.h"
 #include "GroundPlane.h"
 #include "KinematicController.h"
+#include "PhysXDispatcher.h"
 #include <Urho3D/IO/Log.h>
 #include <Urho3D/Resource/ResourceCache.h>
 #include <Urho3D/Graphics/Model.h>
@@ -21,15 +22,232 @@
 #include <Urho3D/Graphics/Graphics.h>
 #include <Urho3D/Graphics/GraphicsImpl.h>
 #include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/CoreEvents.h>
+#include <Urho3D/Container/Sort.h>
+#include <Urho3D/IO/File.h>
+#include <Urho3D/IO/FileSystem.h>
 #include <pvd/PxPvd.h>
 
+namespace Urho3DPhysX
+{
+    static const char* COOKED_MESH_FILE_ID = "UPXM";
+    ///increased when header of cooked mesh file changes, files of other versions are cooked again
+    static const unsigned COOKED_MESH_FILE_VERSION = 3;
+    static const String TRIANGLE_MESH_EXTENSION = ".pxtm";
+    static const String CONVEX_MESH_EXTENSION = ".pxcm";
+    static const PxConvexFlags CONVEX_COOKING_FLAGS = PxConvexFlag::eCOMPUTE_CONVEX | PxConvexFlag::eGPU_COMPATIBLE;
+    ///approximate memory of one PxShape (shape object with its core and geometry), used only by memory report
+    static const unsigned SHAPE_MEMORY_ESTIMATE = 256;
+    ///assumed midphase structure size per triangle, used for memory estimate of directly inserted meshes. Not measured, BVH33/BVH34 layouts differ
+    static const unsigned MIDPHASE_MEMORY_PER_TRIANGLE = 16;
+    ///hull vertex count above which PhysX builds gauss map (big convex data) for convex mesh
+    static const unsigned GAUSS_MAP_MIN_VERTICES = 32;
+    ///assumed gauss map size (6 cube faces, 16x16 subdivision, 2 bytes each), used for memory estimate only
+    static const unsigned GAUSS_MAP_MEMORY = 6 * 16 * 16 * 2;
+
+    static const unsigned long long FNV_OFFSET_BASIS = 14695981039346656037ULL;
+    static const unsigned long long FNV_PRIME = 1099511628211ULL;
+    static const unsigned long long MIX_SEED = 0x9E3779B97F4A7C15ULL;
+    static const unsigned long long MIX_MULTIPLIER = 0xFF51AFD7ED558CCDULL;
+
+    ///64-bit FNV-1a, mesh content is identified by it
+    static unsigned long long HashBytes(unsigned long long hash, const void* data, unsigned size)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (unsigned i = 0; i < size; ++i)
+            hash = (hash ^ bytes[i]) * FNV_PRIME;
+        return hash;
+    }
+
+    ///64-bit multiply-xorshift hash, independent of FNV-1a. Meshes are equal only when both hashes match
+    static unsigned long long MixHashBytes(unsigned long long hash, const void* data, unsigned size)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (unsigned i = 0; i < size; ++i)
+        {
+            hash = (hash + bytes[i] + 1) * MIX_MULTIPLIER;
+            hash ^= hash >> 29;
+        }
+        return hash;
+    }
+
+    static void QuantizeSize(int* dest, float x, float y, float z, float step)
+    {
+        dest[0] = RoundToInt(x / step);
+        dest[1] = RoundToInt(y / step);
+        dest[2] = RoundToInt(z / step);
+    }
+
+    static void CopyPositions(Vector3* dest, const GeometryView& view)
+    {
+        for (unsigned i = 0; i < view.numVertices_; ++i)
+            dest[i] = *reinterpret_cast<const Vector3*>(view.positions_ + i * view.stride_);
+    }
+
+    static void CopyIndices(unsigned char* dest, unsigned destIndexSize, const GeometryView& view, unsigned baseVertex)
+    {
+        for (unsigned i = 0; i < view.numIndices_; ++i)
+        {
+            unsigned index = view.indexSize_ == sizeof(unsigned) ? reinterpret_cast<const unsigned*>(view.indices_)[i] : reinterpret_cast<const unsigned short*>(view.indices_)[i];
+            index = index - view.vertexStart_ + baseVertex;
+            if (destIndexSize == sizeof(unsigned))
+                reinterpret_cast<unsigned*>(dest)[i] = index;
+            else
+                reinterpret_cast<unsigned short*>(dest)[i] = (unsigned short)index;
+        }
+    }
+
+    ///Describe single geometry directly over model data, merge multiple geometries into one pre-sized buffer
+    static void BuildMeshSource(MeshSourceData& data, bool isConvex)
+    {
+        if (data.views_.Size() == 1)
+        {
+            const GeometryView& view = data.views_[0];
+            data.vertexData_ = view.positions_;
+            data.vertexStride_ = view.stride_;
+            if (isConvex)
+                return;
+            data.indexSize_ = view.indexSize_;
+            if (!view.vertexStart_)
+                data.indexData_ = view.indices_;
+            else
+            {
+                //indices address whole vertex buffer, rebase them to first used vertex
+                data.indices_.Resize(view.numIndices_ * data.indexSize_);
+                CopyIndices(&data.indices_[0], data.indexSize_, view, 0);
+                data.indexData_ = &data.indices_[0];
+            }
+            return;
+        }
+        data.vertices_.Resize(data.numVertices_);
+        data.vertexData_ = reinterpret_cast<const unsigned char*>(&data.vertices_[0]);
+        data.vertexStride_ = sizeof(Vector3);
+        if (!isConvex)
+        {
+            data.indexSize_ = data.numVertices_ > M_MAX_UNSIGNED_SHORT ? sizeof(unsigned) : sizeof(unsigned short);
+            data.indices_.Resize(data.numIndices_ * data.indexSize_);
+            data.indexData_ = &data.indices_[0];
+        }
+        unsigned baseVertex = 0;
+        unsigned baseIndex = 0;
+        for (unsigned i = 0; i < data.views_.Size(); ++i)
+        {
+            const GeometryView& view = data.views_[i];
+            CopyPositions(&data.vertices_[baseVertex], view);
+            if (!isConvex)
+                CopyIndices(&data.indices_[baseIndex * data.indexSize_], data.indexSize_, view, baseVertex);
+            baseVertex += view.numVertices_;
+            baseIndex += view.numIndices_;
+        }
+    }
+
+    ///Get full path of cached mesh file
+    static String GetMeshCacheFileName(const String& dir, unsigned long long hash, unsigned lodLevel, const String& extension)
+    {
+        return dir + ToStringHex((unsigned)(hash >> 32)) + ToStringHex((unsigned)hash) + "_" + String(lodLevel) + extension;
+    }
+
+    ///Name index key of model mesh, cooking flags are stored above lod level so meshes cooked with different options don't mix
+    static Pair<StringHash, unsigned> MakeMeshKey(Model* source, unsigned lodLevel, unsigned cookingFlags)
+    {
+        return MakePair(source->GetNameHash(), lodLevel | cookingFlags << 24);
+    }
+
+    ///Unnamed models have no identity to resolve, directly inserted meshes are procedural and rebuilt under the same name
+    static bool IsLookedUpByContent(Model* source, unsigned cookingFlags)
+    {
+        return source->GetName().Empty() || (cookingFlags & MC_DIRECT_INSERTION);
+    }
+
+    ///Only direct insertion changes how convex meshes are created
+    static unsigned GetMeshCookingFlags(unsigned cookingFlags, bool convex)
+    {
+        return convex ? cookingFlags & MC_DIRECT_INSERTION : cookingFlags;
+    }
+
+    ///Estimate memory of mesh inserted without serialization, there is no cooked stream to measure
+    static unsigned EstimateMeshMemory(const PxBase* mesh, bool isConvex, const PxCookingParams& params)
+    {
+        if (isConvex)
+        {
+            const PxConvexMesh* convexMesh = static_cast<const PxConvexMesh*>(mesh);
+            unsigned numVertices = convexMesh->getNbVertices();
+            unsigned numPolygons = convexMesh->getNbPolygons();
+            unsigned size = numVertices * sizeof(PxVec3) + numPolygons * sizeof(PxHullPolygon);
+            //polygon vertex indices are 8-bit
+            PxHullPolygon polygon;
+            for (PxU32 i = 0; i < numPolygons; ++i)
+            {
+                if (convexMesh->getPolygonData(i, polygon))
+                    size += polygon.mNbVerts * sizeof(PxU8);
+            }
+            //hull adjacency: 3 faces per vertex, 2 vertices and 2 faces per edge (Euler: edges = vertices + faces - 2)
+            unsigned numEdges = numVertices + numPolygons > 2 ? numVertices + numPolygons - 2 : 0;
+            size += numVertices * 3 * sizeof(PxU8) + numEdges * 4 * sizeof(PxU8);
+            //large hulls also store gauss map and vertex valencies for support mapping
+            if (numVertices > GAUSS_MAP_MIN_VERTICES)
+                size += GAUSS_MAP_MEMORY + numVertices * sizeof(PxU32) + numEdges * 2 * sizeof(PxU8);
+            return size;
+        }
+        const PxTriangleMesh* triangleMesh = static_cast<const PxTriangleMesh*>(mesh);
+        unsigned indexSize = triangleMesh->getTriangleMeshFlags() & PxTriangleMeshFlag::e16_BIT_INDICES ? sizeof(PxU16) : sizeof(PxU32);
+        unsigned triangleSize = 3 * indexSize + MIDPHASE_MEMORY_PER_TRIANGLE;
+        //3 adjacent triangle indices and active edge flags per triangle, unless disabled by cooking options
+        if (params.buildTriangleAdjacencies)
+            triangleSize += 3 * sizeof(PxU32);
+        if (!(params.meshPreprocessParams & PxMeshPreprocessingFlag::eDISABLE_ACTIVE_EDGES_PRECOMPUTE))
+            triangleSize += sizeof(PxU8);
+        return triangleMesh->getNbVertices() * sizeof(PxVec3) + triangleMesh->getNbTriangles() * triangleSize;
+    }
+
+    static bool CompareLastUsed(const CookedMesh* lhs, const CookedMesh* rhs)
+    {
+        return lhs->lastUsed_ < rhs->lastUsed_;
+    }
+
+    static unsigned long long HashCookingParams(const PxCookingParams& params)
+    {
+        unsigned version = PX_PHYSICS_VERSION;
+        unsigned long long hash = HashBytes(FNV_OFFSET_BASIS, &version, sizeof(version));
+        unsigned preprocessFlags = (PxU32)params.meshPreprocessParams;
+        hash = HashBytes(hash, &preprocessFlags, sizeof(preprocessFlags));
+        unsigned midphase = params.midphaseDesc.getType();
+        hash = HashBytes(hash, &midphase, sizeof(midphase));
+        hash = HashBytes(hash, &params.buildGPUData, sizeof(params.buildGPUData));
+        hash = HashBytes(hash, &params.buildTriangleAdjacencies, sizeof(params.buildTriangleAdjacencies));
+        hash = HashBytes(hash, &params.meshWeldTolerance, sizeof(params.meshWeldTolerance));
+        return hash;
+    }
+}
+
 Urho3DPhysX::Physics::Physics(Context * context) : Object(context),
-logErrors_(true),
 foundation_(nullptr),
+physics_(nullptr),
 cpuDispatcher_(nullptr),
+workQueueDispatcher_(nullptr),
+useWorkQueueDispatcher_(true),
+numWorkerThreads_(0),
 cudaManager_(nullptr),
 cooking_(nullptr),
+meshMemoryBudget_(0),
+meshMemoryUsage_(0),
+meshUseCounter_(0),
+numEvictedMeshes_(0),
+meshEvictionScheduled_(false),
+numSharedShapeUsers_(0),
+shapeScaleStep_(0.001f),
+meshCacheHits_(0),
+meshCacheMisses_(0),
+meshDedupHits_(0),
+meshDedupSavedMemory_(0),
+numCookedMeshes_(0),
+cookingTime_(0),
+peakCookingCopyMemory_(0),
 errorCallback_(this),
+logErrors_(true),
 defBroadPhaseType_(PxBroadPhaseType::Enum::eABP),
 #ifdef _DEBUG
 defEnableGPUDynamics_(false),
@@ -42,24 +260,107 @@ pvd_(nullptr)
 {
 }
 
+Urho3DPhysX::MeshSourceData::MeshSourceData() :
+vertexData_(nullptr),
+vertexStride_(0),
+numVertices_(0),
+indexData_(nullptr),
+indexSize_(0),
+numIndices_(0)
+{
+}
+
+Urho3DPhysX::MeshSourceData::~MeshSourceData()
+{
+}
+
+Urho3DPhysX::MeshCookingJob::MeshCookingJob(const Pair<StringHash, unsigned>& key, unsigned lodLevel, bool isConvex, unsigned cookingFlags) :
+owner_(nullptr),
+key_(key),
+lodLevel_(lodLevel),
+isConvex_(isConvex),
+cookingFlags_(cookingFlags),
+cooking_(nullptr),
+insertionCallback_(nullptr),
+insertedMesh_(nullptr),
+copyMemory_(0),
+hash_(0),
+contentHash_(0),
+duplicate_(false),
+byContent_(false),
+invalidated_(false),
+mesh_(nullptr),
+fromCache_(false),
+cooked_(false),
+cookingTime_(0)
+{
+}
+
+Urho3DPhysX::CookedMesh::CookedMesh(PxBase* mesh, unsigned long long hash, bool isConvex, unsigned memorySize) :
+mesh_(mesh),
+hash_(hash),
+contentHash_(0),
+cooking_(nullptr),
+isConvex_(isConvex),
+memorySize_(memorySize),
+lastUsed_(0)
+{
+}
+
+Urho3DPhysX::CookedMesh::~CookedMesh()
+{
+    if (mesh_)
+        mesh_->release();
+}
+
 Urho3DPhysX::Physics::~Physics()
 {
-    if (triangleMeshesShapes_.Size())
+    //finished jobs must not be handled while physics is destroyed
+    UnsubscribeFromEvent(E_WORKITEMCOMPLETED);
+    //dispatcher removes its workers from WorkQueue, so waiting for cooking jobs doesn't run them on main thread
+    if (workQueueDispatcher_)
+        delete workQueueDispatcher_;
+    else if (cpuDispatcher_)
+        static_cast<PxDefaultCpuDispatcher*>(cpuDispatcher_)->release();
+    workQueueDispatcher_ = nullptr;
+    cpuDispatcher_ = nullptr;
+    if (cookingJobs_.Size())
     {
-        for (HashMap<Pair<StringHash, unsigned>, PxTriangleMesh*>::ConstIterator i = triangleMeshesShapes_.Begin(); i != triangleMeshesShapes_.End(); ++i)
+        //cancel jobs which didn't start yet and wait for ones still running on worker threads
+        auto* queue = GetSubsystem<WorkQueue>();
+        if (queue)
         {
-            i->second_->release();
+            for (auto& job : cookingJobs_)
+            {
+                job->waitingShapes_.Clear();
+                queue->RemoveWorkItem(job->workItem_);
+            }
+            queue->Complete(0);
         }
+        cookingJobs_.Clear();
     }
-    if (convexMeshesShapes_.Size())
+    //pooled shapes reference meshes, release them first. Shapes still attached to actors are released with them
+    for (HashMap<SharedShapeKey, SharedShape>::ConstIterator i = sharedShapes_.Begin(); i != sharedShapes_.End(); ++i)
+        i->second_.shape_->release();
+    sharedShapes_.Clear();
+    sharedShapeKeys_.Clear();
+    //collision shapes may still reference cooked meshes, PhysX meshes must be released before PxPhysics
+    PODVector<CookedMesh*> meshes;
+    GetCookedMeshes(meshes);
+    for (auto* mesh : meshes)
     {
-        for (HashMap<Pair<StringHash, unsigned>, PxConvexMesh*>::ConstIterator i = convexMeshesShapes_.Begin(); i != convexMeshesShapes_.End(); ++i)
-        {
-            i->second_->release();
-        }
+        mesh->mesh_->release();
+        mesh->mesh_ = nullptr;
     }
+    triangleMeshNames_.Clear();
+    convexMeshNames_.Clear();
+    triangleMeshes_.Clear();
+    convexMeshes_.Clear();
     if (defaultMaterial_)
         defaultMaterial_.Reset();
+    for (HashMap<unsigned, PxCooking*>::ConstIterator i = cookings_.Begin(); i != cookings_.End(); ++i)
+        i->second_->release();
+    cookings_.Clear();
     if (cooking_)
         cooking_->release();
     if (physics_)
@@ -92,7 +393,19 @@ bool Urho3DPhysX::Physics::InitializePhysX()
         return false;
     }
     PxInitExtensions(*physics_, pvd_);
-    cpuDispatcher_ = PxDefaultCpuDispatcherCreate(GetNumLogicalCPUs());
+    auto* workQueue = GetSubsystem<WorkQueue>();
+    if (useWorkQueueDispatcher_ && workQueue && workQueue->GetNumThreads())
+    {
+        workQueueDispatcher_ = new WorkQueueDispatcher(workQueue, numWorkerThreads_);
+        cpuDispatcher_ = workQueueDispatcher_;
+        URHO3D_LOGINFO("PhysX tasks will be executed by " + String(workQueueDispatcher_->getWorkerCount()) + " WorkQueue threads.");
+    }
+    else
+    {
+        unsigned numThreads = numWorkerThreads_ ? numWorkerThreads_ : GetNumLogicalCPUs();
+        PxU32* affinityMasks = workerAffinityMasks_.Size() >= numThreads ? workerAffinityMasks_.Buffer() : nullptr;
+        cpuDispatcher_ = PxDefaultCpuDispatcherCreate(numThreads, affinityMasks);
+    }
     PxCudaContextManagerDesc descr;
 #ifdef URHO3D_OPENGL
     descr.graphicsDevice = GetSubsystem<Graphics>()->GetImpl()->GetGLContext();
@@ -109,6 +422,7 @@ bool Urho3DPhysX::Physics::InitializePhysX()
     defaultMaterial_ = SharedPtr<PhysXMaterial>(new PhysXMaterial(context_));
     defaultMaterial_->SetName("DefaultPxMaterial");
     GetSubsystem<ResourceCache>()->AddManualResource(defaultMaterial_);
+    SubscribeToEvent(E_WORKITEMCOMPLETED, URHO3D_HANDLER(Physics, HandleWorkItemCompleted));
     URHO3D_LOGINFO("Initialized PhysX.");
     return true;
 }
@@ -128,142 +442,853 @@ PxTriangleMesh * Urho3DPhysX::Physics::GetOrCreateTriangleMesh(const String & na
 
 PxTriangleMesh * Urho3DPhysX::Physics::GetOrCreateTriangleMesh(Model * source, unsigned lodLevel)
 {
-    if (source)
+    CookedMesh* mesh = GetOrCreateMesh(source, lodLevel, false);
+    return mesh ? mesh->GetTriangleMesh() : nullptr;
+}
+
+PxTriangleMesh* Urho3DPhysX::Physics::RequestTriangleMesh(Model* source, unsigned lodLevel, CollisionShape* requester)
+{
+    CookedMesh* mesh = RequestMesh(source, lodLevel, false, requester);
+    return mesh ? mesh->GetTriangleMesh() : nullptr;
+}
+
+PxConvexMesh * Urho3DPhysX::Physics::GetOrCreateConvexMesh(const String & name, unsigned lodLevel)
+{
+    return GetOrCreateConvexMesh(GetSubsystem<ResourceCache>()->GetResource<Model>(name), lodLevel);
+}
+
+PxConvexMesh * Urho3DPhysX::Physics::GetOrCreateConvexMesh(Model * source, unsigned lodLevel)
+{
+    CookedMesh* mesh = GetOrCreateMesh(source, lodLevel, true);
+    return mesh ? mesh->GetConvexMesh() : nullptr;
+}
+
+PxConvexMesh* Urho3DPhysX::Physics::RequestConvexMesh(Model* source, unsigned lodLevel, CollisionShape* requester)
+{
+    CookedMesh* mesh = RequestMesh(source, lodLevel, true, requester);
+    return mesh ? mesh->GetConvexMesh() : nullptr;
+}
+
+Urho3DPhysX::CookedMesh* Urho3DPhysX::Physics::GetOrCreateMesh(Model* source, unsigned lodLevel, bool convex, unsigned cookingFlags)
+{
+    if (!source)
+        return nullptr;
+    cookingFlags = GetMeshCookingFlags(cookingFlags, convex);
+    Pair<StringHash, unsigned> key = MakeMeshKey(source, lodLevel, cookingFlags);
+    bool byContent = IsLookedUpByContent(source, cookingFlags);
+    CookedMesh* mesh = byContent ? nullptr : FindMesh(key, convex);
+    if (!mesh)
     {
-        PxTriangleMesh* ret(nullptr);
-        Pair<StringHash, unsigned> key(source->GetNameHash(), lodLevel);
-        if (triangleMeshesShapes_.TryGetValue(key, ret))
+        MeshCookingJob job(key, lodLevel, convex, cookingFlags);
+        job.byContent_ = byContent;
+        if (PrepareMeshCookingJob(&job, source))
         {
-            return ret;
+            ProcessMeshCookingJob(&job);
+            if (FinishMeshCookingJob(&job))
+                mesh = job.mesh_;
         }
-        else
+    }
+    return mesh;
+}
+
+Urho3DPhysX::CookedMesh* Urho3DPhysX::Physics::RequestMesh(Model* source, unsigned lodLevel, bool convex, CollisionShape* requester, unsigned cookingFlags)
+{
+    if (!source)
+        return nullptr;
+    cookingFlags = GetMeshCookingFlags(cookingFlags, convex);
+    //mesh is cooked right away when there are no worker threads
+    auto* queue = GetSubsystem<WorkQueue>();
+    if (!queue || !queue->GetNumThreads())
+        return GetOrCreateMesh(source, lodLevel, convex, cookingFlags);
+    if (IsLookedUpByContent(source, cookingFlags))
+        return RequestMeshByContent(source, lodLevel, convex, cookingFlags, requester);
+    Pair<StringHash, unsigned> key = MakeMeshKey(source, lodLevel, cookingFlags);
+    CookedMesh* mesh = FindMesh(key, convex);
+    if (mesh)
+        return mesh;
+    QueueMeshCookingJob(source, lodLevel, convex, cookingFlags, requester);
+    return nullptr;
+}
+
+Urho3DPhysX::CookedMesh* Urho3DPhysX::Physics::FindMesh(const Pair<StringHash, unsigned>& key, bool convex)
+{
+    HashMap<Pair<StringHash, unsigned>, CookedMesh*>& names = convex ? convexMeshNames_ : triangleMeshNames_;
+    HashMap<Pair<StringHash, unsigned>, CookedMesh*>::Iterator i = names.Find(key);
+    if (i == names.End())
+        return nullptr;
+    i->second_->lastUsed_ = ++meshUseCounter_;
+    return i->second_;
+}
+
+void Urho3DPhysX::Physics::InvalidateMesh(Model* source)
+{
+    if (!source)
+        return;
+    StringHash name = source->GetNameHash();
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        HashMap<Pair<StringHash, unsigned>, CookedMesh*>& names = i ? convexMeshNames_ : triangleMeshNames_;
+        for (HashMap<Pair<StringHash, unsigned>, CookedMesh*>::Iterator j = names.Begin(); j != names.End();)
         {
-            //combined index data for indicies
-            PODVector<unsigned short> combinedIndexData;
-            //combined index data for large indicies
-            PODVector<unsigned> combinedLargeIndexData;
-            PODVector<Vector3> verticies;
-            bool indexSizeSet = false;
-            bool isUsingLargeIndicies = false;
-            for (unsigned i = 0; i < source->GetNumGeometries(); ++i)
+            if (j->first_.first_ == name)
             {
-                Geometry* geometry = source->GetGeometry(i, lodLevel);
-                const unsigned char* vertexData;
-                const unsigned char* indexData;
-                unsigned vertexSize;
-                unsigned indexSize;
-                const PODVector<VertexElement>* elements;
-                geometry->GetRawData(vertexData, vertexSize, indexData, indexSize, elements);
-                if (!vertexData || VertexBuffer::GetElementOffset(*elements, TYPE_VECTOR3, SEM_POSITION) != 0)
-                {
-                    __debugbreak();
-                }
-                unsigned vertexStart = geometry->GetVertexStart();
-                unsigned vertexCount = geometry->GetVertexCount();
-                for (unsigned j = 0; j < vertexCount; ++j)
-                {
-                    verticies.Push(*((const Vector3*)(&vertexData[(vertexStart + j) * vertexSize])));
-                }
-                if (!indexSizeSet)
-                {
-                    if (indexSize == sizeof(unsigned))
-                        isUsingLargeIndicies = true;
-                    indexSizeSet = true;
-                }
-                unsigned indexStart = geometry->GetIndexStart();
-                unsigned indexCount = geometry->GetIndexCount();
-                for (unsigned k = 0; k < indexCount; ++k)
-                {
-                    if (!isUsingLargeIndicies)
-                        combinedIndexData.Push(*(const unsigned short*)(&indexData[(k + indexStart) * indexSize]));
-                    else
-                        combinedLargeIndexData.Push(*(const unsigned*)(&indexData[(k + indexStart) * indexSize]));
-                }
+                j->second_->keys_.Remove(j->first_);
+                j = names.Erase(j);
             }
-            PxTriangleMeshDesc descr;
-            descr.points.count = verticies.Size();
-            descr.points.stride = sizeof(Vector3);
-            descr.points.data = verticies.Buffer();
-
-            descr.triangles.count = isUsingLargeIndicies ? combinedLargeIndexData.Size() / 3 : combinedIndexData.Size() / 3;
-            descr.triangles.stride = isUsingLargeIndicies ? sizeof(unsigned) * 3 : sizeof(unsigned short) * 3;
-            descr.triangles.data = isUsingLargeIndicies ? (void*)combinedLargeIndexData.Buffer() : (void*)combinedIndexData.Buffer();
-            if(!isUsingLargeIndicies)
-                descr.flags |= PxMeshFlag::e16_BIT_INDICES;
-
-            PxDefaultMemoryOutputStream writeBuffer;
-            PxTriangleMeshCookingResult::Enum result;
-            bool status = cooking_->cookTriangleMesh(descr, writeBuffer, &result);
-            if (!status)
-            {
-                return nullptr;
-            }
-            PxDefaultMemoryInputData readBuffer(writeBuffer.getData(), writeBuffer.getSize());
-            ret = physics_->createTriangleMesh(readBuffer);
-            triangleMeshesShapes_.Insert(MakePair(key, ret));
-            return ret;            
+            else
+                ++j;
         }
     }
-    return nullptr;
+    //pending jobs may have collected previous geometry, their meshes are found only by content
+    for (auto& job : cookingJobs_)
+    {
+        if (!job->byContent_ && job->key_.first_ == name)
+            job->invalidated_ = true;
+    }
 }
 
-PxConvexMesh * Urho3DPhysX::Physics::GetOrCreateConvexMesh(const String & name, unsigned lodLevel)
+void Urho3DPhysX::Physics::AddMeshKey(CookedMesh* mesh, const Pair<StringHash, unsigned>& key)
 {
-    return GetOrCreateConvexMesh(GetSubsystem<ResourceCache>()->GetResource<Model>(name), lodLevel);
+    HashMap<Pair<StringHash, unsigned>, CookedMesh*>& names = mesh->isConvex_ ? convexMeshNames_ : triangleMeshNames_;
+    CookedMesh*& entry = names[key];
+    if (entry == mesh)
+        return;
+    //model was changed and resolves to other content now
+    if (entry)
+        entry->keys_.Remove(key);
+    entry = mesh;
+    mesh->keys_.Push(key);
 }
 
-PxConvexMesh * Urho3DPhysX::Physics::GetOrCreateConvexMesh(Model * source, unsigned lodLevel)
+void Urho3DPhysX::Physics::AddDuplicateMesh(MeshCookingJob* job, CookedMesh* mesh)
+{
+    job->mesh_ = mesh;
+    mesh->lastUsed_ = ++meshUseCounter_;
+    //request looked up by content is not a different model sharing the mesh
+    if (job->byContent_ || job->invalidated_)
+        return;
+    AddMeshKey(mesh, job->key_);
+    ++meshDedupHits_;
+    meshDedupSavedMemory_ += mesh->memorySize_;
+}
+
+void Urho3DPhysX::Physics::ReleaseMesh(SharedPtr<CookedMesh>& mesh)
+{
+    if (!mesh)
+        return;
+    bool unused = mesh->Refs() == 2;
+    mesh.Reset();
+    if (unused && meshMemoryBudget_ && meshMemoryUsage_ > meshMemoryBudget_)
+        ScheduleMeshEviction();
+}
+
+void Urho3DPhysX::Physics::SetMeshMemoryBudget(unsigned bytes)
+{
+    meshMemoryBudget_ = bytes;
+    if (meshMemoryBudget_ && meshMemoryUsage_ > meshMemoryBudget_)
+        ScheduleMeshEviction();
+}
+
+unsigned Urho3DPhysX::Physics::GetCookedMeshMemory(Model* source, unsigned lodLevel, bool convex, unsigned cookingFlags) const
+{
+    if (!source)
+        return 0;
+    cookingFlags = GetMeshCookingFlags(cookingFlags, convex);
+    if (IsLookedUpByContent(source, cookingFlags))
+        return 0;
+    const HashMap<Pair<StringHash, unsigned>, CookedMesh*>& names = convex ? convexMeshNames_ : triangleMeshNames_;
+    HashMap<Pair<StringHash, unsigned>, CookedMesh*>::ConstIterator i = names.Find(MakeMeshKey(source, lodLevel, cookingFlags));
+    return i != names.End() ? i->second_->memorySize_ : 0;
+}
+
+void Urho3DPhysX::Physics::GetCookedMeshes(PODVector<CookedMesh*>& dest) const
+{
+    dest.Clear();
+    dest.Reserve(triangleMeshes_.Size() + convexMeshes_.Size());
+    for (HashMap<unsigned long long, SharedPtr<CookedMesh> >::ConstIterator i = triangleMeshes_.Begin(); i != triangleMeshes_.End(); ++i)
+        dest.Push(i->second_);
+    for (HashMap<unsigned long long, SharedPtr<CookedMesh> >::ConstIterator i = convexMeshes_.Begin(); i != convexMeshes_.End(); ++i)
+        dest.Push(i->second_);
+}
+
+void Urho3DPhysX::Physics::ReleaseUnusedMeshes()
+{
+    EvictMeshes(0);
+}
+
+void Urho3DPhysX::Physics::EvictMeshes(unsigned budget)
+{
+    PODVector<CookedMesh*> unused;
+    GetCookedMeshes(unused);
+    for (unsigned i = 0; i < unused.Size();)
+    {
+        if (unused[i]->IsUsed())
+            unused.EraseSwap(i);
+        else
+            ++i;
+    }
+    //least recently used first
+    Sort(unused.Begin(), unused.End(), CompareLastUsed);
+    for (unsigned i = 0; i < unused.Size() && meshMemoryUsage_ > budget; ++i)
+    {
+        CookedMesh* mesh = unused[i];
+        meshMemoryUsage_ -= mesh->memorySize_;
+        ++numEvictedMeshes_;
+        HashMap<Pair<StringHash, unsigned>, CookedMesh*>& names = mesh->isConvex_ ? convexMeshNames_ : triangleMeshNames_;
+        for (unsigned j = 0; j < mesh->keys_.Size(); ++j)
+            names.Erase(mesh->keys_[j]);
+        //last reference, PhysX mesh is released here
+        MutexLock lock(meshesMutex_);
+        if (mesh->isConvex_)
+            convexMeshes_.Erase(mesh->hash_);
+        else
+            triangleMeshes_.Erase(mesh->hash_);
+    }
+}
+
+void Urho3DPhysX::Physics::ScheduleMeshEviction()
+{
+    //evicted at the end of frame, so meshes released and requested again by rebuilt shapes stay resident
+    if (!meshEvictionScheduled_)
+    {
+        meshEvictionScheduled_ = true;
+        SubscribeToEvent(E_ENDFRAME, URHO3D_HANDLER(Physics, HandleEndFrame));
+    }
+}
+
+void Urho3DPhysX::Physics::HandleEndFrame(StringHash eventType, VariantMap& eventData)
+{
+    UnsubscribeFromEvent(E_ENDFRAME);
+    meshEvictionScheduled_ = false;
+    if (meshMemoryBudget_)
+        EvictMeshes(meshMemoryBudget_);
+}
+
+unsigned Urho3DPhysX::SharedShapeKey::ToHash() const
+{
+    unsigned hash = type_;
+    hash = hash * 31 + size_[0];
+    hash = hash * 31 + size_[1];
+    hash = hash * 31 + size_[2];
+    hash = hash * 31 + MakeHash(mesh_);
+    hash = hash * 31 + MakeHash(material_);
+    hash = hash * 31 + simulationFilter_.word0;
+    hash = hash * 31 + simulationFilter_.word1;
+    hash = hash * 31 + simulationFilter_.word3;
+    hash = hash * 31 + flags_;
+    return hash;
+}
+
+bool Urho3DPhysX::SharedShapeKey::operator==(const SharedShapeKey& rhs) const
+{
+    return type_ == rhs.type_ && size_[0] == rhs.size_[0] && size_[1] == rhs.size_[1] && size_[2] == rhs.size_[2] &&
+        mesh_ == rhs.mesh_ && material_ == rhs.material_ && localPose_ == rhs.localPose_ &&
+        simulationFilter_ == rhs.simulationFilter_ && queryFilter_ == rhs.queryFilter_ && flags_ == rhs.flags_;
+}
+
+PxShape* Urho3DPhysX::Physics::AcquireSharedShape(const PxGeometryHolder& geometry, PxMaterial* material, const PxTransform& localPose, const PxFilterData& simulationFilter, const PxFilterData& queryFilter, PxShapeFlags flags)
 {
-    if (source)
+    if (!physics_ || !material)
+        return nullptr;
+    SharedShapeKey key;
+    key.type_ = geometry.getType();
+    key.size_[0] = key.size_[1] = key.size_[2] = 0;
+    key.mesh_ = nullptr;
+    switch (key.type_)
     {
-        PxConvexMesh* ret(nullptr);
-        Pair<StringHash, unsigned> key(source->GetNameHash(), lodLevel);
-        if (convexMeshesShapes_.TryGetValue(key, ret))
+    case PxGeometryType::eBOX:
+    {
+        const PxVec3& halfExtents = geometry.box().halfExtents;
+        QuantizeSize(key.size_, halfExtents.x, halfExtents.y, halfExtents.z, shapeScaleStep_);
+    }
+        break;
+    case PxGeometryType::eSPHERE:
+        QuantizeSize(key.size_, geometry.sphere().radius, 0.0f, 0.0f, shapeScaleStep_);
+        break;
+    case PxGeometryType::eCAPSULE:
+        QuantizeSize(key.size_, geometry.capsule().radius, geometry.capsule().halfHeight, 0.0f, shapeScaleStep_);
+        break;
+    case PxGeometryType::eCONVEXMESH:
+    {
+        const PxVec3& scale = geometry.convexMesh().scale.scale;
+        QuantizeSize(key.size_, scale.x, scale.y, scale.z, shapeScaleStep_);
+        key.mesh_ = geometry.convexMesh().convexMesh;
+    }
+        break;
+    case PxGeometryType::eTRIANGLEMESH:
+    {
+        const PxVec3& scale = geometry.triangleMesh().scale.scale;
+        QuantizeSize(key.size_, scale.x, scale.y, scale.z, shapeScaleStep_);
+        key.mesh_ = geometry.triangleMesh().triangleMesh;
+    }
+        break;
+    default:
+        break;
+    }
+    key.material_ = material;
+    key.localPose_ = localPose;
+    key.simulationFilter_ = simulationFilter;
+    key.queryFilter_ = queryFilter;
+    key.flags_ = (PxU32)flags;
+
+    HashMap<SharedShapeKey, SharedShape>::Iterator i = sharedShapes_.Find(key);
+    if (i != sharedShapes_.End())
+    {
+        ++i->second_.numUsers_;
+        ++numSharedShapeUsers_;
+        return i->second_.shape_;
+    }
+    //geometry of first user is used by all shapes in the same scale bucket
+    PxShape* shape = physics_->createShape(geometry.any(), *material, false, flags);
+    if (!shape)
+        return nullptr;
+    shape->setLocalPose(localPose);
+    shape->setSimulationFilterData(simulationFilter);
+    shape->setQueryFilterData(queryFilter);
+    //shared by many collision shapes, owner is found through actor
+    shape->userData = nullptr;
+    SharedShape& shared = sharedShapes_[key];
+    shared.shape_ = shape;
+    shared.numUsers_ = 1;
+    sharedShapeKeys_[shape] = key;
+    ++numSharedShapeUsers_;
+    return shape;
+}
+
+void Urho3DPhysX::Physics::ReleaseSharedShape(PxShape* shape)
+{
+    HashMap<PxShape*, SharedShapeKey>::Iterator keyIt = sharedShapeKeys_.Find(shape);
+    if (keyIt == sharedShapeKeys_.End())
+        return;
+    HashMap<SharedShapeKey, SharedShape>::Iterator i = sharedShapes_.Find(keyIt->second_);
+    if (i != sharedShapes_.End())
+    {
+        --numSharedShapeUsers_;
+        if (--i->second_.numUsers_)
+            return;
+        //actors hold their own references, shape is destroyed when detached from all of them
+        i->second_.shape_->release();
+        sharedShapes_.Erase(i);
+    }
+    sharedShapeKeys_.Erase(keyIt);
+}
+
+String Urho3DPhysX::Physics::GetShapeMemoryReport() const
+{
+    unsigned numShapes = sharedShapes_.Size();
+    unsigned numSaved = numSharedShapeUsers_ - numShapes;
+    String report;
+    report.AppendWithFormat("Shared shapes: %u PxShapes used by %u collision shapes, %u PxShapes saved (~%.1f KB)",
+        numShapes, numSharedShapeUsers_, numSaved, numSaved * SHAPE_MEMORY_ESTIMATE / 1024.0f);
+    return report;
+}
+
+unsigned Urho3DPhysX::Physics::GetNumPendingCookingJobs() const
+{
+    return cookingJobs_.Size();
+}
+
+bool Urho3DPhysX::Physics::PrepareMeshCookingJob(MeshCookingJob* job, Model* source)
+{
+    HiresTimer timer;
+    job->owner_ = this;
+    job->cooking_ = GetCooking(job->cookingFlags_);
+    if (!job->cooking_)
+        return false;
+    //directly inserted meshes have no serialized data to store
+    if (job->cookingFlags_ & MC_DIRECT_INSERTION)
+        job->insertionCallback_ = &physics_->getPhysicsInsertionCallback();
+    else
+        job->cacheDir_ = meshCacheDir_;
+    MeshSourceData& data = job->data_;
+    for (unsigned i = 0; i < source->GetNumGeometries(); ++i)
+    {
+        Geometry* geometry = source->GetGeometry(i, job->lodLevel_);
+        if (!geometry)
+            continue;
+        const unsigned char* vertexData;
+        const unsigned char* indexData;
+        unsigned vertexSize;
+        unsigned indexSize;
+        const PODVector<VertexElement>* elements;
+        geometry->GetRawData(vertexData, vertexSize, indexData, indexSize, elements);
+        unsigned positionOffset = vertexData && elements ? VertexBuffer::GetElementOffset(*elements, TYPE_VECTOR3, SEM_POSITION) : M_MAX_UNSIGNED;
+        if (positionOffset == M_MAX_UNSIGNED)
         {
-            return ret;
+            URHO3D_LOGERROR("Geometry " + String(i) + " of model " + source->GetName() + " has no CPU side position data, excluding it from collision mesh.");
+            continue;
         }
+        if (!job->isConvex_ && (!indexData || !geometry->GetIndexCount()))
+        {
+            URHO3D_LOGERROR("Geometry " + String(i) + " of model " + source->GetName() + " has no CPU side index data, excluding it from collision mesh.");
+            continue;
+        }
+        GeometryView view;
+        view.vertexStart_ = geometry->GetVertexStart();
+        view.numVertices_ = geometry->GetVertexCount();
+        view.stride_ = vertexSize;
+        view.positions_ = vertexData + view.vertexStart_ * vertexSize + positionOffset;
+        view.indexSize_ = indexSize;
+        view.numIndices_ = job->isConvex_ ? 0 : geometry->GetIndexCount();
+        view.indices_ = indexData ? indexData + geometry->GetIndexStart() * indexSize : nullptr;
+        data.views_.Push(view);
+        data.geometries_.Push(SharedPtr<Geometry>(geometry));
+        data.numVertices_ += view.numVertices_;
+        data.numIndices_ += view.numIndices_;
+    }
+    job->cookingTime_ += timer.GetUSec(false);
+    if (!data.numVertices_)
+    {
+        URHO3D_LOGERROR("Model " + source->GetName() + " has no geometry usable for collision mesh.");
+        return false;
+    }
+    return true;
+}
+
+void Urho3DPhysX::Physics::HashMeshCookingJob(MeshCookingJob* job) const
+{
+    //source is already built and hashed when job is processed again or was hashed on main thread
+    if (job->data_.vertexData_)
+        return;
+    BuildMeshSource(job->data_, job->isConvex_);
+    job->copyMemory_ = job->data_.vertices_.Size() * (unsigned)sizeof(Vector3) + job->data_.indices_.Size();
+    CalculateMeshHash(job);
+}
+
+void Urho3DPhysX::Physics::ProcessMeshCookingJob(MeshCookingJob* job)
+{
+    HiresTimer timer;
+    HashMeshCookingJob(job);
+    {
+        //mesh may still be evicted before job is finished, it's resolved again on main thread
+        MutexLock lock(meshesMutex_);
+        job->duplicate_ = FindMeshByContent(job) != nullptr;
+    }
+    job->cookingTime_ += timer.GetUSec(false);
+    if (job->duplicate_)
+        return;
+    if (!job->cacheDir_.Empty())
+    {
+        job->cacheFileName_ = GetMeshCacheFileName(job->cacheDir_, job->hash_, job->lodLevel_, job->isConvex_ ? CONVEX_MESH_EXTENSION : TRIANGLE_MESH_EXTENSION);
+        job->fromCache_ = LoadCookedMesh(job);
+    }
+    CookMesh(job);
+    //file is written by worker too, main thread only creates the mesh
+    if (job->cooked_ && !job->insertedMesh_ && !job->cacheFileName_.Empty())
+        SaveCookedMesh(job);
+}
+
+void Urho3DPhysX::Physics::CookMesh(MeshCookingJob* job)
+{
+    if (job->fromCache_ || job->duplicate_)
+        return;
+    HiresTimer timer;
+    const MeshSourceData& data = job->data_;
+    if (!job->isConvex_)
+    {
+        PxTriangleMeshDesc descr;
+        descr.points.count = data.numVertices_;
+        descr.points.stride = data.vertexStride_;
+        descr.points.data = data.vertexData_;
+
+        descr.triangles.count = data.numIndices_ / 3;
+        descr.triangles.stride = data.indexSize_ * 3;
+        descr.triangles.data = data.indexData_;
+        if (data.indexSize_ == sizeof(unsigned short))
+            descr.flags |= PxMeshFlag::e16_BIT_INDICES;
+
+        PxTriangleMeshCookingResult::Enum result;
+        //mesh factory of PxPhysics is locked on insertion, it can be done from worker thread
+        if (job->insertionCallback_)
+            job->insertedMesh_ = job->cooking_->createTriangleMesh(descr, *job->insertionCallback_, &result);
         else
+            job->cooked_ = job->cooking_->cookTriangleMesh(descr, job->stream_, &result);
+    }
+    else
+    {
+        PxConvexMeshDesc descr;
+        descr.points.count = data.numVertices_;
+        descr.points.stride = data.vertexStride_;
+        descr.points.data = data.vertexData_;
+        descr.flags = CONVEX_COOKING_FLAGS;
+        if (job->insertionCallback_)
+            job->insertedMesh_ = job->cooking_->createConvexMesh(descr, *job->insertionCallback_);
+        else
+            job->cooked_ = job->cooking_->cookConvexMesh(descr, job->stream_);
+    }
+    if (job->insertedMesh_)
+        job->cooked_ = true;
+    job->cookingTime_ += timer.GetUSec(false);
+}
+
+bool Urho3DPhysX::Physics::FinishMeshCookingJob(MeshCookingJob* job)
+{
+    peakCookingCopyMemory_ = Max(peakCookingCopyMemory_, job->copyMemory_);
+    //models with identical geometry resolve to one mesh, also when other job cooked it in the meantime
+    CookedMesh* existing = FindMeshByContent(job);
+    if (existing)
+    {
+        if (job->insertedMesh_)
+        {
+            job->insertedMesh_->release();
+            job->insertedMesh_ = nullptr;
+        }
+        AddDuplicateMesh(job, existing);
+        return true;
+    }
+    if (job->duplicate_)
+    {
+        //matching mesh was evicted, background jobs are requeued before getting here
+        job->duplicate_ = false;
+        ProcessMeshCookingJob(job);
+    }
+    if (job->fromCache_)
+    {
+        PxDefaultMemoryInputData cachedBuffer(job->cachedData_.Buffer(), job->cachedData_.Size());
+        if (InsertMesh(job, cachedBuffer, job->cachedData_.Size()))
         {
-            PODVector<Vector3> verticies;
-            unsigned numGeometries = source->GetNumGeometries();
-            for (unsigned i = 0; i < numGeometries; ++i)
+            ++meshCacheHits_;
+            return true;
+        }
+        //cached file is unusable, cook mesh again and replace it
+        job->fromCache_ = false;
+        CookMesh(job);
+        if (job->cooked_)
+            SaveCookedMesh(job);
+    }
+    if (!job->cacheFileName_.Empty())
+        ++meshCacheMisses_;
+    if (!job->cooked_)
+    {
+        URHO3D_LOGERROR(String("Failed to cook ") + (job->isConvex_ ? "convex" : "triangle") + " mesh.");
+        return false;
+    }
+    ++numCookedMeshes_;
+    cookingTime_ += job->cookingTime_;
+    if (job->insertedMesh_)
+    {
+        AddCookedMesh(job, job->insertedMesh_, EstimateMeshMemory(job->insertedMesh_, job->isConvex_, job->cooking_->getParams()));
+        return true;
+    }
+    PxDefaultMemoryInputData readBuffer(job->stream_.getData(), job->stream_.getSize());
+    return InsertMesh(job, readBuffer, job->stream_.getSize());
+}
+
+bool Urho3DPhysX::Physics::InsertMesh(MeshCookingJob* job, PxInputStream& stream, unsigned memorySize)
+{
+    PxBase* mesh = nullptr;
+    if (!job->isConvex_)
+        mesh = physics_->createTriangleMesh(stream);
+    else
+        mesh = physics_->createConvexMesh(stream);
+    if (!mesh)
+        return false;
+    AddCookedMesh(job, mesh, memorySize);
+    return true;
+}
+
+void Urho3DPhysX::Physics::AddCookedMesh(MeshCookingJob* job, PxBase* mesh, unsigned memorySize)
+{
+    HashMap<unsigned long long, SharedPtr<CookedMesh> >& meshes = job->isConvex_ ? convexMeshes_ : triangleMeshes_;
+    //hash collision with different content, next free value is used
+    unsigned long long key = job->hash_;
+    while (meshes.Contains(key))
+        ++key;
+    SharedPtr<CookedMesh> cookedMesh(new CookedMesh(mesh, key, job->isConvex_, memorySize));
+    cookedMesh->contentHash_ = job->contentHash_;
+    cookedMesh->cooking_ = job->cooking_;
+    cookedMesh->lastUsed_ = ++meshUseCounter_;
+    {
+        MutexLock lock(meshesMutex_);
+        meshes[key] = cookedMesh;
+    }
+    job->mesh_ = cookedMesh;
+    if (!job->byContent_ && !job->invalidated_)
+        AddMeshKey(cookedMesh, job->key_);
+    meshMemoryUsage_ += memorySize;
+    if (meshMemoryBudget_ && meshMemoryUsage_ > meshMemoryBudget_)
+        ScheduleMeshEviction();
+}
+
+Urho3DPhysX::CookedMesh* Urho3DPhysX::Physics::FindMeshByContent(MeshCookingJob* job) const
+{
+    const HashMap<unsigned long long, SharedPtr<CookedMesh> >& meshes = job->isConvex_ ? convexMeshes_ : triangleMeshes_;
+    //colliding meshes are stored under following values. Evicted mesh leaves a gap, then content may be cooked again, but never mixed up
+    for (unsigned long long key = job->hash_;; ++key)
+    {
+        HashMap<unsigned long long, SharedPtr<CookedMesh> >::ConstIterator i = meshes.Find(key);
+        if (i == meshes.End())
+            return nullptr;
+        const CookedMesh* mesh = i->second_;
+        if (mesh->contentHash_ == job->contentHash_ && mesh->cooking_ == job->cooking_)
+            return i->second_;
+    }
+}
+
+PxCooking* Urho3DPhysX::Physics::GetCooking(unsigned cookingFlags)
+{
+    //direct insertion doesn't change cooking params
+    unsigned paramFlags = cookingFlags & ~MC_DIRECT_INSERTION;
+    if (!paramFlags || !cooking_)
+        return cooking_;
+    HashMap<unsigned, PxCooking*>::Iterator i = cookings_.Find(paramFlags);
+    if (i != cookings_.End())
+        return i->second_;
+    //params are not changed on shared cooking, jobs using it may run on worker threads
+    PxCookingParams params = cooking_->getParams();
+    if (paramFlags & MC_DISABLE_CLEANING)
+        params.meshPreprocessParams |= PxMeshPreprocessingFlag::eDISABLE_CLEAN_MESH;
+    if (paramFlags & MC_BVH34)
+        params.midphaseDesc.setToDefault(PxMeshMidPhase::eBVH34);
+    if (paramFlags & MC_NO_ADJACENCY)
+    {
+        params.buildTriangleAdjacencies = false;
+        params.meshPreprocessParams |= PxMeshPreprocessingFlag::eDISABLE_ACTIVE_EDGES_PRECOMPUTE;
+    }
+    PxCooking* cooking = PxCreateCooking(PX_PHYSICS_VERSION, *foundation_, params);
+    if (!cooking)
+    {
+        URHO3D_LOGERROR("Failed to create PhysX cooking for flags " + String(paramFlags));
+        return nullptr;
+    }
+    cookings_[paramFlags] = cooking;
+    return cooking;
+}
+
+bool Urho3DPhysX::Physics::QueueMeshCookingJob(Model* source, unsigned lodLevel, bool isConvex, unsigned cookingFlags, CollisionShape* requester)
+{
+    Pair<StringHash, unsigned> key = MakeMeshKey(source, lodLevel, cookingFlags);
+    //coalesce requests for the same model, lod and cooking options
+    for (auto& job : cookingJobs_)
+    {
+        if (!job->byContent_ && !job->invalidated_ && job->key_ == key && job->isConvex_ == isConvex)
+        {
+            AddWaitingShape(job, requester);
+            return true;
+        }
+    }
+    SharedPtr<MeshCookingJob> job(new MeshCookingJob(key, lodLevel, isConvex, cookingFlags));
+    if (!PrepareMeshCookingJob(job, source))
+        return false;
+    //merging, hashing, disk cache lookup and cooking are done on worker thread
+    AddWaitingShape(job, requester);
+    cookingJobs_.Push(job);
+    AddMeshCookingWorkItem(job);
+    return true;
+}
+
+Urho3DPhysX::CookedMesh* Urho3DPhysX::Physics::RequestMeshByContent(Model* source, unsigned lodLevel, bool isConvex, unsigned cookingFlags, CollisionShape* requester)
+{
+    SharedPtr<MeshCookingJob> job(new MeshCookingJob(MakeMeshKey(source, lodLevel, cookingFlags), lodLevel, isConvex, cookingFlags));
+    job->byContent_ = true;
+    if (!PrepareMeshCookingJob(job, source))
+        return nullptr;
+    //hashing is much cheaper than cooking, it's done on main thread so the mesh is found when shape requests it again
+    HiresTimer timer;
+    HashMeshCookingJob(job);
+    job->cookingTime_ += timer.GetUSec(false);
+    CookedMesh* mesh = FindMeshByContent(job);
+    if (mesh)
+    {
+        mesh->lastUsed_ = ++meshUseCounter_;
+        return mesh;
+    }
+    //coalesce requests for the same content, hashes of content jobs are set before they are queued
+    for (auto& pending : cookingJobs_)
+    {
+        if (pending->byContent_ && pending->isConvex_ == isConvex && pending->hash_ == job->hash_ &&
+            pending->contentHash_ == job->contentHash_ && pending->cooking_ == job->cooking_)
+        {
+            AddWaitingShape(pending, requester);
+            return nullptr;
+        }
+    }
+    AddWaitingShape(job, requester);
+    cookingJobs_.Push(job);
+    AddMeshCookingWorkItem(job);
+    return nullptr;
+}
+
+void Urho3DPhysX::Physics::AddWaitingShape(MeshCookingJob* job, CollisionShape* requester)
+{
+    if (!requester)
+        return;
+    WeakPtr<CollisionShape> waitingShape(requester);
+    if (!job->waitingShapes_.Contains(waitingShape))
+        job->waitingShapes_.Push(waitingShape);
+    requester->meshPending_ = true;
+}
+
+void Urho3DPhysX::Physics::AddMeshCookingWorkItem(MeshCookingJob* job)
+{
+    auto* queue = GetSubsystem<WorkQueue>();
+    SharedPtr<WorkItem> item = queue->GetFreeItem();
+    item->workFunction_ = CookMeshWork;
+    item->aux_ = job;
+    item->priority_ = 0;
+    item->sendEvent_ = true;
+    job->workItem_ = item;
+    queue->AddWorkItem(item);
+}
+
+void Urho3DPhysX::Physics::CookMeshWork(const WorkItem* item, unsigned threadIndex)
+{
+    auto* job = static_cast<MeshCookingJob*>(item->aux_);
+    job->owner_->ProcessMeshCookingJob(job);
+}
+
+void Urho3DPhysX::Physics::HandleWorkItemCompleted(StringHash eventType, VariantMap& eventData)
+{
+    using namespace WorkItemCompleted;
+    auto* item = static_cast<WorkItem*>(eventData[P_ITEM].GetPtr());
+    if (!item || item->workFunction_ != CookMeshWork)
+        return;
+    for (unsigned i = 0; i < cookingJobs_.Size(); ++i)
+    {
+        if (cookingJobs_[i].Get() == item->aux_)
+        {
+            SharedPtr<MeshCookingJob> job = cookingJobs_[i];
+            if (job->duplicate_ && !FindMeshByContent(job))
             {
-                Geometry* geometry = source->GetGeometry(i, lodLevel);
-                const unsigned char* vertexData;
-                const unsigned char* indexData;
-                unsigned vertexSize;
-                unsigned indexSize;
-                const PODVector<VertexElement>* elements;
-                geometry->GetRawData(vertexData, vertexSize, indexData, indexSize, elements);
-                if (!vertexData || VertexBuffer::GetElementOffset(*elements, TYPE_VECTOR3, SEM_POSITION) != 0)
-                {
-                    __debugbreak();
-                }
-                unsigned vertexStart = geometry->GetVertexStart();
-                unsigned vertexCount = geometry->GetVertexCount();
-                for (unsigned i = 0; i < vertexCount; ++i)
-                {
-                    verticies.Push(*((const Vector3*)(&vertexData[(vertexStart + i) * vertexSize])));
-                }
+                //matching mesh was evicted after worker found it, look up disk cache and cook on worker again
+                job->duplicate_ = false;
+                AddMeshCookingWorkItem(job);
+                break;
             }
-            PxConvexMeshDesc descr;
-            descr.points.count = verticies.Size();
-            descr.points.stride = sizeof(Vector3);
-            descr.points.data = verticies.Buffer();
-            descr.flags |= PxConvexFlag::eCOMPUTE_CONVEX;
-            descr.flags |= PxConvexFlag::eGPU_COMPATIBLE;
-            PxDefaultMemoryOutputStream writeBuffer;
-            if (!cooking_->cookConvexMesh(descr, writeBuffer))
+            cookingJobs_.Erase(i);
+            bool success = FinishMeshCookingJob(job);
+            for (auto& shape : job->waitingShapes_)
             {
-                return nullptr;
+                if (shape)
+                    shape->OnMeshCooked(success);
             }
-            PxDefaultMemoryInputData readBuffer(writeBuffer.getData(), writeBuffer.getSize());
-            ret = physics_->createConvexMesh(readBuffer);
-            convexMeshesShapes_.Insert(MakePair(key, ret));
-            return ret;
+            break;
         }
     }
-    return nullptr;
+}
+
+void Urho3DPhysX::Physics::SetMeshCacheDir(const String& dir)
+{
+    if (dir.Empty())
+    {
+        meshCacheDir_.Clear();
+        return;
+    }
+    auto* fileSystem = GetSubsystem<FileSystem>();
+    String path = AddTrailingSlash(dir);
+    if (!fileSystem->DirExists(path) && !fileSystem->CreateDir(path))
+    {
+        URHO3D_LOGERROR("Failed to create mesh cache directory " + path);
+        meshCacheDir_.Clear();
+        return;
+    }
+    meshCacheDir_ = path;
+}
+
+void Urho3DPhysX::Physics::ResetMeshCacheStats()
+{
+    meshCacheHits_ = 0;
+    meshCacheMisses_ = 0;
+    meshDedupHits_ = 0;
+    meshDedupSavedMemory_ = 0;
+    numCookedMeshes_ = 0;
+    cookingTime_ = 0;
+    peakCookingCopyMemory_ = 0;
+}
+
+void Urho3DPhysX::Physics::CalculateMeshHash(MeshCookingJob* job) const
+{
+    const MeshSourceData& data = job->data_;
+    unsigned long long hash = HashCookingParams(job->cooking_->getParams());
+    //content hash doesn't need params, meshes are compared by cooking interface too
+    unsigned long long contentHash = MIX_SEED;
+    unsigned sizes[] = { data.numVertices_, data.numIndices_ };
+    hash = HashBytes(hash, sizes, sizeof(sizes));
+    contentHash = MixHashBytes(contentHash, sizes, sizeof(sizes));
+    //positions are hashed through stride, vertex data may be interleaved
+    for (unsigned i = 0; i < data.numVertices_; ++i)
+    {
+        const unsigned char* position = data.vertexData_ + i * data.vertexStride_;
+        hash = HashBytes(hash, position, sizeof(Vector3));
+        contentHash = MixHashBytes(contentHash, position, sizeof(Vector3));
+    }
+    if (job->isConvex_)
+    {
+        unsigned convexFlags = (PxU32)CONVEX_COOKING_FLAGS;
+        hash = HashBytes(hash, &convexFlags, sizeof(convexFlags));
+        contentHash = MixHashBytes(contentHash, &convexFlags, sizeof(convexFlags));
+    }
+    else
+    {
+        hash = HashBytes(hash, data.indexData_, data.numIndices_ * data.indexSize_);
+        contentHash = MixHashBytes(contentHash, &data.indexSize_, sizeof(data.indexSize_));
+        contentHash = MixHashBytes(contentHash, data.indexData_, data.numIndices_ * data.indexSize_);
+    }
+    job->hash_ = hash;
+    job->contentHash_ = contentHash;
+}
+
+bool Urho3DPhysX::Physics::LoadCookedMesh(MeshCookingJob* job) const
+{
+    const String& fileName = job->cacheFileName_;
+    const MeshSourceData& source = job->data_;
+    if (!GetSubsystem<FileSystem>()->FileExists(fileName))
+        return false;
+    File file(context_, fileName, FILE_READ);
+    if (!file.IsOpen() || file.ReadFileID() != COOKED_MESH_FILE_ID || file.ReadUInt() != COOKED_MESH_FILE_VERSION)
+    {
+        URHO3D_LOGWARNING("Invalid cooked mesh file " + fileName);
+        return false;
+    }
+    //file name is derived from primary hash only, independent content hash and sizes of source data must match too
+    unsigned long long fileHash = file.ReadUInt64();
+    unsigned long long contentHash = file.ReadUInt64();
+    unsigned numVertices = file.ReadUInt();
+    unsigned numIndices = file.ReadUInt();
+    unsigned indexSize = file.ReadUInt();
+    if (fileHash != job->hash_ || contentHash != job->contentHash_ || numVertices != source.numVertices_ || numIndices != source.numIndices_ ||
+        indexSize != source.indexSize_)
+    {
+        URHO3D_LOGWARNING("Cooked mesh file " + fileName + " was written for different model data, mesh will be cooked again");
+        return false;
+    }
+    unsigned size = file.ReadUInt();
+    unsigned long long checksum = file.ReadUInt64();
+    PODVector<unsigned char>& data = job->cachedData_;
+    if (!size || size > file.GetSize() - file.GetPosition())
+        return false;
+    data.Resize(size);
+    //truncated or damaged stream would be rejected by PhysX at best
+    if (file.Read(data.Buffer(), size) != size || HashBytes(FNV_OFFSET_BASIS, data.Buffer(), size) != checksum)
+    {
+        URHO3D_LOGWARNING("Cooked mesh file " + fileName + " is damaged, mesh will be cooked again");
+        data.Clear();
+        return false;
+    }
+    return true;
+}
+
+void Urho3DPhysX::Physics::SaveCookedMesh(const MeshCookingJob* job) const
+{
+    File file(context_, job->cacheFileName_, FILE_WRITE);
+    if (!file.IsOpen())
+    {
+        URHO3D_LOGWARNING("Failed to write cooked mesh file " + job->cacheFileName_);
+        return;
+    }
+    const MeshSourceData& source = job->data_;
+    const unsigned char* data = job->stream_.getData();
+    unsigned size = job->stream_.getSize();
+    file.WriteFileID(COOKED_MESH_FILE_ID);
+    file.WriteUInt(COOKED_MESH_FILE_VERSION);
+    file.WriteUInt64(job->hash_);
+    file.WriteUInt64(job->contentHash_);
+    file.WriteUInt(source.numVertices_);
+    file.WriteUInt(source.numIndices_);
+    file.WriteUInt(source.indexSize_);
+    file.WriteUInt(size);
+    file.WriteUInt64(HashBytes(FNV_OFFSET_BASIS, data, size));
+    file.Write(data, size);
 }
 
 void Urho3DPhysX::Physics::SendErrorEvent(int code, const String & message, const String& file, int line)
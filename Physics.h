@@ -1,11 +1,14 @@
 #pragma once
 #include "PhysXEvents.h"
 #include <Urho3D/Core/Object.h>
+#include <Urho3D/Core/Mutex.h>
 #include <PxPhysicsAPI.h>
 
 namespace Urho3D
 {
     class Model;
+    class Geometry;
+    struct WorkItem;
 }
 using namespace Urho3D;
 using namespace physx;
@@ -13,6 +16,149 @@ using namespace physx;
 namespace Urho3DPhysX
 {
     class PhysXMaterial;
+    class CollisionShape;
+    class WorkQueueDispatcher;
+
+    class Physics;
+
+    ///Positions and indices of one model geometry inside its vertex and index data
+    struct GeometryView
+    {
+        const unsigned char* positions_;
+        unsigned stride_;
+        unsigned numVertices_;
+        const unsigned char* indices_;
+        unsigned indexSize_;
+        unsigned numIndices_;
+        ///indices of geometry address whole vertex buffer, not only its range
+        unsigned vertexStart_;
+    };
+
+    ///Mesh data of model geometries. Single geometry is described directly over its vertex and index data, multiple geometries are merged
+    struct MeshSourceData
+    {
+        MeshSourceData();
+        ~MeshSourceData();
+
+        ///geometries collected on main thread, described or merged by cooking job
+        PODVector<GeometryView> views_;
+        ///positions, stride is vertex size of source buffer
+        const unsigned char* vertexData_;
+        unsigned vertexStride_;
+        unsigned numVertices_;
+        ///16 or 32 bit indices, relative to first position
+        const unsigned char* indexData_;
+        unsigned indexSize_;
+        unsigned numIndices_;
+        ///merged positions, used only when there is more than one geometry
+        PODVector<Vector3> vertices_;
+        ///merged or rebased indices
+        PODVector<unsigned char> indices_;
+        ///keep source buffers alive while mesh is cooked on worker thread
+        Vector<SharedPtr<Geometry> > geometries_;
+    };
+
+    ///Key of pooled shape, collision shapes with equal keys use the same non-exclusive PxShape
+    struct SharedShapeKey
+    {
+        ///
+        unsigned ToHash() const;
+        ///
+        bool operator ==(const SharedShapeKey& rhs) const;
+
+        PxGeometryType::Enum type_;
+        ///geometry dimensions (half extents, radius, mesh scale...) quantized to shape scale step
+        int size_[3];
+        ///triangle or convex mesh
+        void* mesh_;
+        PxMaterial* material_;
+        PxTransform localPose_;
+        PxFilterData simulationFilter_;
+        PxFilterData queryFilter_;
+        unsigned flags_;
+    };
+
+    ///Pooled shape and number of collision shapes using it
+    struct SharedShape
+    {
+        PxShape* shape_;
+        unsigned numUsers_;
+    };
+
+    ///Cooked triangle or convex mesh stored in mesh cache. Collision shapes hold references to meshes they use, meshes without them can be evicted
+    struct CookedMesh : public RefCounted
+    {
+        CookedMesh(PxBase* mesh, unsigned long long hash, bool isConvex, unsigned memorySize);
+        ~CookedMesh();
+        ///
+        PxTriangleMesh* GetTriangleMesh() const { return isConvex_ ? nullptr : static_cast<PxTriangleMesh*>(mesh_); }
+        ///
+        PxConvexMesh* GetConvexMesh() const { return isConvex_ ? static_cast<PxConvexMesh*>(mesh_) : nullptr; }
+        ///Check if any collision shape holds a reference, cache holds one too
+        bool IsUsed() const { return Refs() > 1; }
+
+        PxBase* mesh_;
+        ///key in mesh cache, hash of source vertex and index data and cooking params. Next free value is used when hashes of different meshes collide
+        unsigned long long hash_;
+        ///second hash of source data computed by independent function, request is resolved to this mesh only when both hashes match
+        unsigned long long contentHash_;
+        ///cooking interface used, meshes cooked with different params never match
+        const PxCooking* cooking_;
+        ///name keys (model name, lod level and cooking flags) resolved to this mesh, models with identical geometry share it. Empty for meshes looked up by content only
+        Vector<Pair<StringHash, unsigned> > keys_;
+        bool isConvex_;
+        ///size of cooked data in bytes, estimated from mesh sizes for meshes inserted without cooked stream
+        unsigned memorySize_;
+        ///cache use counter value when mesh was last requested
+        unsigned lastUsed_;
+    };
+
+    ///Cooking of single triangle or convex mesh, may be executed on worker thread
+    struct MeshCookingJob : public RefCounted
+    {
+        MeshCookingJob(const Pair<StringHash, unsigned>& key, unsigned lodLevel, bool isConvex, unsigned cookingFlags);
+
+        Physics* owner_;
+        Pair<StringHash, unsigned> key_;
+        unsigned lodLevel_;
+        bool isConvex_;
+        ///PhysXMeshCookingFlag
+        unsigned cookingFlags_;
+        PxCooking* cooking_;
+        ///set for direct insertion, cooked mesh is created without serialization
+        PxPhysicsInsertionCallback* insertionCallback_;
+        ///mesh created by direct insertion
+        PxBase* insertedMesh_;
+        MeshSourceData data_;
+        ///bytes copied to merge or rebase source data
+        unsigned copyMemory_;
+        ///content hash, also used by disk cache
+        unsigned long long hash_;
+        ///independent second content hash
+        unsigned long long contentHash_;
+        ///mesh with the same content was in cache when job was processed, it's resolved again when job is finished
+        bool duplicate_;
+        ///mesh is looked up by content only (unnamed model, direct insertion), job was hashed on main thread before it was queued
+        bool byContent_;
+        ///model was invalidated while job was pending, its name isn't resolved to created mesh
+        bool invalidated_;
+        ///resulting mesh, cooked or found by content
+        CookedMesh* mesh_;
+        ///disk cache directory, empty if disk cache is not used
+        String cacheDir_;
+        String cacheFileName_;
+        PODVector<unsigned char> cachedData_;
+        bool fromCache_;
+        ///cooking result
+        PxDefaultMemoryOutputStream stream_;
+        bool cooked_;
+        ///time spent collecting source data and cooking
+        long long cookingTime_;
+        ///shapes waiting for this mesh
+        Vector<WeakPtr<CollisionShape> > waitingShapes_;
+        ///work item processing the job, removed from WorkQueue if job is cancelled before it starts
+        SharedPtr<WorkItem> workItem_;
+    };
 
     class URHOPX_API Physics : public Object
     {
@@ -24,6 +170,22 @@ namespace Urho3DPhysX
 
         ///Initialize Physx sdk
         bool InitializePhysX();
+        ///Execute PhysX tasks on Urho3D WorkQueue threads instead of separate PhysX thread pool. Must be set before InitializePhysX. True by default
+        void SetUseWorkQueueDispatcher(bool enable) { useWorkQueueDispatcher_ = enable; }
+        ///
+        bool GetUseWorkQueueDispatcher() const { return useWorkQueueDispatcher_; }
+        ///Set max number of threads executing PhysX tasks, 0 - use all WorkQueue threads or all logical CPUs. Must be set before InitializePhysX
+        void SetNumWorkerThreads(unsigned num) { numWorkerThreads_ = num; }
+        ///
+        unsigned GetNumWorkerThreads() const { return numWorkerThreads_; }
+        ///Set affinity masks of PhysX threads, one mask per thread. Used only by default PhysX dispatcher (WorkQueue threads are owned by Urho3D). Must be set before InitializePhysX
+        void SetWorkerAffinityMasks(const PODVector<unsigned>& masks) { workerAffinityMasks_ = masks; }
+        ///
+        const PODVector<unsigned>& GetWorkerAffinityMasks() const { return workerAffinityMasks_; }
+        ///Check if PhysX tasks are executed by WorkQueue threads
+        bool IsUsingWorkQueueDispatcher() const { return workQueueDispatcher_ != nullptr; }
+        ///Get WorkQueue dispatcher, null if PhysX's own thread pool is used
+        WorkQueueDispatcher* GetWorkQueueDispatcher() const { return workQueueDispatcher_; }
         ///
         PxFoundation* GetFoundation() { return foundation_; }
         ///
@@ -43,6 +205,49 @@ namespace Urho3DPhysX
         PxConvexMesh* GetOrCreateConvexMesh(const String& name, unsigned lodLevel);
         ///Get convex mesh or create new one if not created yet
         PxConvexMesh* GetOrCreateConvexMesh(Model* source, unsigned lodLevel);
+        ///Get triangle mesh if already created, otherwise queue background cooking and notify requesting shape when done. Returns null while cooking is pending.
+        PxTriangleMesh* RequestTriangleMesh(Model* source, unsigned lodLevel, CollisionShape* requester);
+        ///Get convex mesh if already created, otherwise queue background cooking and notify requesting shape when done. Returns null while cooking is pending.
+        PxConvexMesh* RequestConvexMesh(Model* source, unsigned lodLevel, CollisionShape* requester);
+        ///Get shape from the pool or create new one if none matches. Returned shape is non-exclusive and must not be modified, release it with ReleaseSharedShape
+        PxShape* AcquireSharedShape(const PxGeometryHolder& geometry, PxMaterial* material, const PxTransform& localPose, const PxFilterData& simulationFilter, const PxFilterData& queryFilter, PxShapeFlags flags);
+        ///Release shape acquired from the pool, shape is destroyed when its last user releases it
+        void ReleaseSharedShape(PxShape* shape);
+        ///Set size step used to compare geometry of shared shapes, shapes with world scale differing less than that will share PxShape. Default 0.001
+        void SetShapeScaleStep(float step) { shapeScaleStep_ = Max(step, M_EPSILON); }
+        ///
+        float GetShapeScaleStep() const { return shapeScaleStep_; }
+        ///Number of PxShapes in the pool
+        unsigned GetNumSharedShapes() const { return sharedShapes_.Size(); }
+        ///Number of collision shapes using pooled PxShapes
+        unsigned GetNumSharedShapeUsers() const { return numSharedShapeUsers_; }
+        ///Get shape pool summary with estimated memory saved by sharing
+        String GetShapeMemoryReport() const;
+        ///Get cooked mesh from cache or cook it now with given PhysXMeshCookingFlag options. Collision shapes keep SharedPtr to meshes they use
+        CookedMesh* GetOrCreateMesh(Model* source, unsigned lodLevel, bool convex, unsigned cookingFlags = 0);
+        ///Get cooked mesh if already in cache, otherwise queue background cooking and notify requesting shape when done. Returns null while cooking is pending.
+        CookedMesh* RequestMesh(Model* source, unsigned lodLevel, bool convex, CollisionShape* requester, unsigned cookingFlags = 0);
+        ///Stop resolving model name to its cooked meshes, call after rebuilding geometry of a named model. Next request hashes its content again. Unnamed models and MC_DIRECT_INSERTION meshes are always looked up by content
+        void InvalidateMesh(Model* source);
+        ///Release mesh reference held by collision shape. Unused meshes over memory budget are evicted at the end of frame
+        void ReleaseMesh(SharedPtr<CookedMesh>& mesh);
+        ///Set memory budget for cooked meshes in bytes, least recently used meshes not used by any shape are evicted when it's exceeded. 0 - unlimited (default)
+        void SetMeshMemoryBudget(unsigned bytes);
+        ///
+        unsigned GetMeshMemoryBudget() const { return meshMemoryBudget_; }
+        ///Get total size of cooked meshes resident in cache
+        unsigned GetMeshMemoryUsage() const { return meshMemoryUsage_; }
+        ///Get size of cooked mesh in bytes, 0 if it's not in cache or is looked up by content (unnamed model, MC_DIRECT_INSERTION), use GetCookedMeshes for those. Size of cooked stream for serialized meshes.
+        ///Memory of directly inserted meshes (CookedMesh::memorySize_, counted in GetMeshMemoryUsage) is only an estimate from vertex, polygon and triangle counts with assumed midphase and gauss map sizes
+        unsigned GetCookedMeshMemory(Model* source, unsigned lodLevel, bool convex, unsigned cookingFlags = 0) const;
+        ///Get all meshes resident in cache
+        void GetCookedMeshes(PODVector<CookedMesh*>& dest) const;
+        ///Number of meshes evicted from cache
+        unsigned GetNumEvictedMeshes() const { return numEvictedMeshes_; }
+        ///Release all cached meshes not used by any collision shape, e.g. after unloading part of the world
+        void ReleaseUnusedMeshes();
+        ///Number of meshes being cooked on worker threads
+        unsigned GetNumPendingCookingJobs() const;
         ///
         const ErrorCallback& GetErrorCallback() const { return errorCallback_; }
         ///Send error event, called from error callback
@@ -63,20 +268,124 @@ namespace Urho3DPhysX
         void SetDefUseCCD(bool val) { defUseCCD_ = val; }
         ///
         bool GetDefUseCCD() const { return defUseCCD_; }
+        ///Set directory used to store cooked meshes between runs. Empty string disables disk cache.
+        void SetMeshCacheDir(const String& dir);
+        ///
+        const String& GetMeshCacheDir() const { return meshCacheDir_; }
+        ///Number of meshes loaded from disk cache
+        unsigned GetMeshCacheHits() const { return meshCacheHits_; }
+        ///Number of meshes that had to be cooked because they weren't found in disk cache
+        unsigned GetMeshCacheMisses() const { return meshCacheMisses_; }
+        ///Number of requests resolved to already cooked mesh of other model with identical geometry
+        unsigned GetMeshDedupHits() const { return meshDedupHits_; }
+        ///Memory of meshes that didn't have to be stored again thanks to deduplication
+        unsigned GetMeshDedupSavedMemory() const { return meshDedupSavedMemory_; }
+        ///Number of meshes cooked since last stats reset (not loaded from disk cache or deduplicated)
+        unsigned GetNumCookedMeshes() const { return numCookedMeshes_; }
+        ///Time in milliseconds spent collecting source data and cooking meshes
+        float GetCookingTime() const { return cookingTime_ / 1000.0f; }
+        ///Largest copy of source data made for single mesh in bytes, meshes from single geometry are cooked without copying
+        unsigned GetPeakCookingCopyMemory() const { return peakCookingCopyMemory_; }
+        ///
+        void ResetMeshCacheStats();
 
     private:
+        ///Collect geometries of model, source data is built by ProcessMeshCookingJob
+        bool PrepareMeshCookingJob(MeshCookingJob* job, Model* source);
+        ///Merge source data and calculate its hashes, done only once per job. Safe to call from worker thread
+        void HashMeshCookingJob(MeshCookingJob* job) const;
+        ///Merge source data, hash it, check disk cache and cook. Safe to call from worker thread
+        void ProcessMeshCookingJob(MeshCookingJob* job);
+        ///Cook mesh data into memory stream or insert it directly, safe to call from worker thread
+        static void CookMesh(MeshCookingJob* job);
+        ///Create mesh from cooked or cached data and store it
+        bool FinishMeshCookingJob(MeshCookingJob* job);
+        ///
+        bool InsertMesh(MeshCookingJob* job, PxInputStream& stream, unsigned memorySize);
+        ///Store created mesh in cache
+        void AddCookedMesh(MeshCookingJob* job, PxBase* mesh, unsigned memorySize);
+        ///Find cached mesh with the same hashes and cooking params as job's mesh. Caller must hold meshesMutex_ when called from worker thread
+        CookedMesh* FindMeshByContent(MeshCookingJob* job) const;
+        ///Get cooking interface for given PhysXMeshCookingFlag options, created on first use
+        PxCooking* GetCooking(unsigned cookingFlags);
+        ///Find mesh in cache and mark it as used
+        CookedMesh* FindMesh(const Pair<StringHash, unsigned>& key, bool convex);
+        ///Resolve model name and lod level to given mesh
+        void AddMeshKey(CookedMesh* mesh, const Pair<StringHash, unsigned>& key);
+        ///Resolve job's model to mesh with the same content
+        void AddDuplicateMesh(MeshCookingJob* job, CookedMesh* mesh);
+        ///Evict least recently used meshes not used by shapes until memory usage fits in budget
+        void EvictMeshes(unsigned budget);
+        ///Evict meshes at the end of frame
+        void ScheduleMeshEviction();
+        ///
+        void HandleEndFrame(StringHash eventType, VariantMap& eventData);
+        ///Queue background cooking on worker threads, returns false if model has no usable source data. Failure is logged
+        bool QueueMeshCookingJob(Model* source, unsigned lodLevel, bool isConvex, unsigned cookingFlags, CollisionShape* requester);
+        ///Find mesh by content or queue background cooking for model without name key
+        CookedMesh* RequestMeshByContent(Model* source, unsigned lodLevel, bool isConvex, unsigned cookingFlags, CollisionShape* requester);
+        ///Add requesting shape to job's waiting shapes
+        void AddWaitingShape(MeshCookingJob* job, CollisionShape* requester);
+        ///Add work item processing job on worker thread
+        void AddMeshCookingWorkItem(MeshCookingJob* job);
+        ///Work item function
+        static void CookMeshWork(const WorkItem* item, unsigned threadIndex);
+        ///
+        void HandleWorkItemCompleted(StringHash eventType, VariantMap& eventData);
+        ///Calculate both content hashes of job's mesh data, primary one is combined with cooking params
+        void CalculateMeshHash(MeshCookingJob* job) const;
+        ///Read cooked mesh stream of job from disk cache if file was written for the same source data and stream checksum matches, safe to call from worker thread
+        bool LoadCookedMesh(MeshCookingJob* job) const;
+        ///Write cooked mesh stream of job to disk cache, safe to call from worker thread
+        void SaveCookedMesh(const MeshCookingJob* job) const;
         PxFoundation* foundation_;
         PxPhysics* physics_;
         PxDefaultAllocator defaultAllocator_;
         PxCpuDispatcher* cpuDispatcher_;
+        ///set when PhysX tasks are executed by WorkQueue
+        WorkQueueDispatcher* workQueueDispatcher_;
+        bool useWorkQueueDispatcher_;
+        unsigned numWorkerThreads_;
+        PODVector<unsigned> workerAffinityMasks_;
         PxCudaContextManager* cudaManager_;
         PxCooking* cooking_;
+        ///cooking interfaces with non-default params by their PhysXMeshCookingFlag options
+        HashMap<unsigned, PxCooking*> cookings_;
         ///default material
         SharedPtr<PhysXMaterial> defaultMaterial_;
-        ///triangle meshes
-        HashMap<Pair<StringHash, unsigned>, PxTriangleMesh*> triangleMeshesShapes_;
-        ///convex meshes
-        HashMap<Pair<StringHash, unsigned>, PxConvexMesh*> convexMeshesShapes_;
+        ///triangle meshes by content hash
+        HashMap<unsigned long long, SharedPtr<CookedMesh> > triangleMeshes_;
+        ///convex meshes by content hash
+        HashMap<unsigned long long, SharedPtr<CookedMesh> > convexMeshes_;
+        ///guards changes of mesh maps, cooking jobs check hashes of cached meshes on worker threads
+        mutable Mutex meshesMutex_;
+        ///model name, lod level and cooking flags to triangle mesh
+        HashMap<Pair<StringHash, unsigned>, CookedMesh*> triangleMeshNames_;
+        ///model name, lod level and cooking flags to convex mesh
+        HashMap<Pair<StringHash, unsigned>, CookedMesh*> convexMeshNames_;
+        unsigned meshMemoryBudget_;
+        unsigned meshMemoryUsage_;
+        ///incremented on every mesh request, used for LRU eviction
+        unsigned meshUseCounter_;
+        unsigned numEvictedMeshes_;
+        bool meshEvictionScheduled_;
+        ///shared shapes
+        HashMap<SharedShapeKey, SharedShape> sharedShapes_;
+        ///keys of shared shapes for release
+        HashMap<PxShape*, SharedShapeKey> sharedShapeKeys_;
+        unsigned numSharedShapeUsers_;
+        float shapeScaleStep_;
+        ///disk cache directory for cooked meshes
+        String meshCacheDir_;
+        unsigned meshCacheHits_;
+        unsigned meshCacheMisses_;
+        unsigned meshDedupHits_;
+        unsigned meshDedupSavedMemory_;
+        unsigned numCookedMeshes_;
+        long long cookingTime_;
+        unsigned peakCookingCopyMemory_;
+        ///meshes being cooked on worker threads
+        Vector<SharedPtr<MeshCookingJob> > cookingJobs_;
         ///callbacks
         ErrorCallback errorCallback_;
         ///If enabled, error messagess will be logged immidietly. True by defualt
@@ -6,8 +6,8 @@
 #include <extensions/PxPrismaticJoint.h>
 
 Urho3DPhysX::PrismaticJoint::PrismaticJoint(Context * context) : Joint(context),
-lowerLimit_(-1.0f),
 upperLimit_(1.0f),
+lowerLimit_(-1.0f),
 contactDistance_(-1.0f),
 limitEnabled_(false)
 {
@@ -6,11 +6,36 @@
 #include <Urho3D/IO/Log.h>
 #include <Urho3D/Graphics/DebugRenderer.h>
 
+namespace Urho3DPhysX
+{
+    static const char* transformSyncModeNames[] =
+    {
+        "Physics driven",
+        "Node driven",
+        "Kinematic target",
+        nullptr
+    };
+}
+
 Urho3DPhysX::RigidActor::RigidActor(Context * context) : Component(context),
-isApplyingTransform_(false),
+actor_(nullptr),
 pxScene_(nullptr),
-lastPosition_(Vector3::ZERO),
-lastRotation_(Quaternion::IDENTITY)
+isApplyingTransform_(false),
+contactReportFlags_(CR_NONE),
+transformSyncMode_(PHYSICS_DRIVEN_SYNC),
+nodeDrivenWarning_(false),
+transformDirtyIndex_(M_MAX_UNSIGNED),
+previousPosition_(Vector3::ZERO),
+previousRotation_(Quaternion::IDENTITY),
+targetPosition_(Vector3::ZERO),
+targetRotation_(Quaternion::IDENTITY),
+sceneIndex_(M_MAX_UNSIGNED),
+pendingIndex_(M_MAX_UNSIGNED),
+massDirtyIndex_(M_MAX_UNSIGNED),
+interpolationIndex_(M_MAX_UNSIGNED),
+interpolationStep_(0),
+lastRotation_(Quaternion::IDENTITY),
+lastPosition_(Vector3::ZERO)
 {
 }
 
@@ -22,6 +47,8 @@ Urho3DPhysX::RigidActor::~RigidActor()
 void Urho3DPhysX::RigidActor::RegisterObject(Context * context)
 {
     context->RegisterFactory<RigidActor>();
+    URHO3D_ENUM_ACCESSOR_ATTRIBUTE("Transform sync mode", GetTransformSyncMode, SetTransformSyncMode, PhysXTransformSyncMode, transformSyncModeNames, PHYSICS_DRIVEN_SYNC, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Contact report flags", GetContactReportFlags, SetContactReportFlags, unsigned, CR_NONE, AM_DEFAULT);
 }
 
 void Urho3DPhysX::RigidActor::DrawDebugGeometry(DebugRenderer * debug, bool depthTest)
@@ -49,7 +76,8 @@ void Urho3DPhysX::RigidActor::OnSetEnabled()
 
 bool Urho3DPhysX::RigidActor::AttachShape(CollisionShape * shape, bool updateMassAndInteria)
 {
-    if (shape && actor_)
+    //shape may not be built yet, it attaches itself when geometry is created
+    if (shape && shape->GetShape() && actor_)
     {
         if (actor_->attachShape(*shape->GetShape()))
         {
@@ -60,6 +88,20 @@ bool Urho3DPhysX::RigidActor::AttachShape(CollisionShape * shape, bool updateMas
     return false;
 }
 
+Urho3DPhysX::CollisionShape* Urho3DPhysX::RigidActor::GetCollisionShape(const PxShape* shape) const
+{
+    if (!node_ || !shape)
+        return nullptr;
+    const Vector<SharedPtr<Component> >& components = node_->GetComponents();
+    for (unsigned i = 0; i < components.Size(); ++i)
+    {
+        CollisionShape* collisionShape = components[i]->Cast<CollisionShape>();
+        if (collisionShape && collisionShape->GetShape() == shape)
+            return collisionShape;
+    }
+    return nullptr;
+}
+
 void Urho3DPhysX::RigidActor::ApplyWorldTransformFromActor()
 {
     if (actor_)
@@ -74,9 +116,13 @@ void Urho3DPhysX::RigidActor::ApplyWorldTransform(const Vector3 & worldPosition,
     if (node_)
     {
         isApplyingTransform_ = true;
-        node_->SetWorldPosition(worldPosition);
+        //set position and rotation together, so node and its listeners are marked dirty only once
+        Node* parent = node_->GetParent();
+        if (!parent || parent == node_->GetScene())
+            node_->SetTransform(worldPosition, worldRotation);
+        else
+            node_->SetTransform(parent->GetWorldTransform().Inverse() * worldPosition, parent->GetWorldRotation().Inverse() * worldRotation);
         lastPosition_ = worldPosition;
-        node_->SetWorldRotation(worldRotation);
         lastRotation_ = worldRotation;
         isApplyingTransform_ = false;
     }
@@ -125,6 +171,65 @@ void Urho3DPhysX::RigidActor::RemoveJoint(Joint * joint)
     }
 }
 
+void Urho3DPhysX::RigidActor::SetTransformSyncMode(PhysXTransformSyncMode mode)
+{
+    transformSyncMode_ = mode;
+}
+
+bool Urho3DPhysX::RigidActor::IsNodeDriven()
+{
+    if (transformSyncMode_ != NODE_DRIVEN_SYNC)
+        return false;
+    //actor reported as active is moved by simulation, its node won't follow
+    if (!nodeDrivenWarning_)
+    {
+        PxRigidDynamic* rigidDynamic = actor_ ? actor_->is<PxRigidDynamic>() : nullptr;
+        if (rigidDynamic && !(rigidDynamic->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC))
+        {
+            nodeDrivenWarning_ = true;
+            URHO3D_LOGWARNING("Simulated dynamic body of node " + (node_ ? node_->GetName() : String::EMPTY) +
+                " uses node driven transform sync and will drift from its node, make it kinematic or use other sync mode");
+        }
+    }
+    return true;
+}
+
+void Urho3DPhysX::RigidActor::FlushNodeTransform()
+{
+    if (!node_ || !actor_)
+        return;
+    if (transformSyncMode_ == KINEMATIC_TARGET_SYNC)
+    {
+        PxRigidDynamic* rigidDynamic = actor_->is<PxRigidDynamic>();
+        if (rigidDynamic && rigidDynamic->getScene() && (rigidDynamic->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC))
+        {
+            lastPosition_ = node_->GetWorldPosition();
+            lastRotation_ = node_->GetWorldRotation();
+            rigidDynamic->setKinematicTarget(ToPxTransform(lastPosition_, lastRotation_));
+            return;
+        }
+    }
+    UpdateTransformFromNode();
+}
+
+void Urho3DPhysX::RigidActor::SetContactReportFlags(unsigned flags)
+{
+    if (contactReportFlags_ != flags)
+    {
+        contactReportFlags_ = flags;
+        if (node_)
+        {
+            PODVector<CollisionShape*> shapes;
+            node_->GetComponents<CollisionShape>(shapes);
+            for (auto* shape : shapes)
+            {
+                if (shape->GetRigidActor() == this)
+                    shape->UpdateFilterData();
+            }
+        }
+    }
+}
+
 void Urho3DPhysX::RigidActor::RemoveFromScene()
 {
     if (pxScene_)
@@ -136,11 +241,12 @@ void Urho3DPhysX::RigidActor::ReleaseActor()
 {
     if (actor_)
     {
-        PxShape* shapes;
-        actor_->getShapes(&shapes, actor_->getNbShapes());
-        for (unsigned i = 0; i < actor_->getNbShapes(); ++i)
+        PODVector<PxShape*> shapes(actor_->getNbShapes());
+        if (!shapes.Empty())
+            actor_->getShapes(&shapes[0], shapes.Size());
+        for (unsigned i = 0; i < shapes.Size(); ++i)
         {
-            actor_->detachShape(shapes[i]);
+            actor_->detachShape(*shapes[i]);
         }
         if(pxScene_)
             pxScene_->RemoveActor(this);
@@ -181,5 +287,12 @@ void Urho3DPhysX::RigidActor::OnMarkedDirty(Node * node)
 {
     if (isApplyingTransform_)
         return;
-    UpdateTransformFromNode();
+    //node can be moved many times per frame, actor is updated once before next simulation step
+    if (pxScene_)
+    {
+        if (transformDirtyIndex_ == M_MAX_UNSIGNED)
+            pxScene_->MarkTransformDirty(this);
+    }
+    else if (actor_)
+        UpdateTransformFromNode();
 }
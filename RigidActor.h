@@ -12,10 +12,23 @@ namespace Urho3DPhysX
     class CollisionShape;
     class Joint;
 
+    enum URHOPX_API PhysXTransformSyncMode
+    {
+        ///simulation results are written to node, node changes teleport actor before next step
+        PHYSICS_DRIVEN_SYNC = 0,
+        ///node is authoritative, node changes are applied before next step and results aren't written back.
+        ///Meant for static and kinematic actors, simulated dynamic body drifts away from its node (warning is logged).
+        ///Node dirty listener stays installed, only the actor update is deferred to the scene's dirty list
+        NODE_DRIVEN_SYNC,
+        ///node changes of kinematic body are applied as kinematic target, other bodies behave like physics driven
+        KINEMATIC_TARGET_SYNC
+    };
+
     class URHOPX_API RigidActor : public Component
     {
         URHO3D_OBJECT(RigidActor, Component);
         friend class Joint;
+        friend class PhysXScene;
     public:
         RigidActor(Context* context);
         virtual ~RigidActor();
@@ -27,6 +40,8 @@ namespace Urho3DPhysX
         void OnSetEnabled() override;
         ///Attach collision shape
         virtual bool AttachShape(CollisionShape* shape, bool updateMassAndInteria = true);
+        ///Find collision shape of this actor's node using given PhysX shape. Needed for shared shapes which have no user data
+        CollisionShape* GetCollisionShape(const PxShape* shape) const;
         ///Apply world transform from the actor
         void ApplyWorldTransformFromActor();
         ///Apply world transform to the node
@@ -47,21 +62,56 @@ namespace Urho3DPhysX
         void ReleaseActor();
         ///
         PxRigidActor* GetActor() { return actor_; }
+        ///
+        PhysXScene* GetPhysXScene() const { return pxScene_; }
+        ///Set how node and actor transforms are synchronized. Node changes are tracked through OnMarkedDirty in all modes
+        void SetTransformSyncMode(PhysXTransformSyncMode mode);
+        ///
+        PhysXTransformSyncMode GetTransformSyncMode() const { return transformSyncMode_; }
+        ///Set contact reports (PhysXContactReportFlag) for all shapes of this actor
+        void SetContactReportFlags(unsigned flags);
+        ///
+        unsigned GetContactReportFlags() const { return contactReportFlags_; }
     protected:
         virtual void OnJointAdded(Joint* joint) {};
         virtual void OnJointRemoved(Joint* joint) {};
         void OnSceneSet(Scene* scene) override;
         void OnNodeSet(Node* node) override;
         void OnMarkedDirty(Node* node) override;
+        ///Check if simulation results are not written to node, warns once about simulated dynamic body in node driven mode
+        bool IsNodeDriven();
         PxRigidActor* actor_;
         WeakPtr<PhysXScene> pxScene_;
         PODVector<Joint*> joints_;
         bool isApplyingTransform_;
+        unsigned contactReportFlags_;
+        PhysXTransformSyncMode transformSyncMode_;
+        ///warning about simulated body in node driven mode was logged
+        bool nodeDrivenWarning_;
+        ///index in scene's dirty transforms, M_MAX_UNSIGNED if node wasn't moved since last flush
+        unsigned transformDirtyIndex_;
+        ///poses of last two simulation steps, used by scene's transform interpolation
+        Vector3 previousPosition_;
+        Quaternion previousRotation_;
+        Vector3 targetPosition_;
+        Quaternion targetRotation_;
+        ///index in scene's registered actors, M_MAX_UNSIGNED if not added to scene
+        unsigned sceneIndex_;
+        ///index in scene's actors waiting for deferred insertion to PhysX scene, M_MAX_UNSIGNED if not pending
+        unsigned pendingIndex_;
+        ///index in scene's mass update list, M_MAX_UNSIGNED if not queued
+        unsigned massDirtyIndex_;
+        ///index in scene's interpolated actors, M_MAX_UNSIGNED if not interpolated
+        unsigned interpolationIndex_;
+        ///last step in which actor was active
+        unsigned interpolationStep_;
 
         Quaternion lastRotation_;
         Vector3 lastPosition_;
 
     private:
+        ///Apply node transform queued by OnMarkedDirty, called by scene before simulation step
+        void FlushNodeTransform();
         ///
         void AddJoint(Joint* joint);
         ///
@@ -1,5 +1,6 @@
 #include "RigidBody.h"
 #include "CollisionShape.h"
+#include "PhysXScene.h"
 #include <Urho3D/Core/Context.h>
 #include <Urho3D/IO/Log.h>
 #include <PxRigidBody.h>
@@ -41,7 +42,7 @@ void Urho3DPhysX::RigidBody::RegisterObject(Context * context)
 
 bool Urho3DPhysX::RigidBody::AttachShape(CollisionShape * shape, bool updateMassAndInteria)
 {
-    if (shape)
+    if (shape && shape->GetShape())
     {
         ///check if shape doesn't require kinematic flag
         PhysXShapeType type = shape->GetShapeType();
@@ -50,6 +51,12 @@ bool Urho3DPhysX::RigidBody::AttachShape(CollisionShape * shape, bool updateMass
             PxRigidBody* body = actor_->is<PxRigidBody>();
             if (body && !(body->getRigidBodyFlags() & PxRigidBodyFlag::eKINEMATIC))
             {
+                //shared shape can't be modified, shape is recreated as exclusive and attaches itself
+                if (shape->IsUsingSharedShape())
+                {
+                    shape->UpdateShape();
+                    return shape->GetShape() != nullptr;
+                }
                 URHO3D_LOGWARNING("Attempt to set triangle mesh/plane/heightfield collision shape on non-kinematic body. Exluding collision shape from simulation.");
                 shape->GetShape()->setFlag(PxShapeFlag::eSIMULATION_SHAPE, false);  //alterative: set kinematic
             }
@@ -58,7 +65,7 @@ bool Urho3DPhysX::RigidBody::AttachShape(CollisionShape * shape, bool updateMass
     if (RigidActor::AttachShape(shape))
     {
         if(updateMassAndInteria)
-            UpdateMassAndInertia();
+            MarkDirty();
         return true;
     }
     return false;
@@ -66,17 +73,25 @@ bool Urho3DPhysX::RigidBody::AttachShape(CollisionShape * shape, bool updateMass
 
 void Urho3DPhysX::RigidBody::ApplyAttributes()
 {
-    if (isDirty_)
+    //bodies in scene are updated before next simulation step
+    if (isDirty_ && !pxScene_)
         UpdateMassAndInertia();
 }
 
+void Urho3DPhysX::RigidBody::MarkDirty()
+{
+    isDirty_ = true;
+    if (pxScene_)
+        pxScene_->MarkMassDirty(this);
+}
+
 void Urho3DPhysX::RigidBody::SetMass(float mass)
 {
     mass = Max(mass, 0.0f);
     if (mass != mass_)
     {
         mass_ = mass;
-        UpdateMassAndInertia();
+        MarkDirty();
     }
 }
 
@@ -89,7 +104,7 @@ void Urho3DPhysX::RigidBody::SetCenterOfMass(const Vector3 & center)
         if (body)
         {
             body->setCMassLocalPose(ToPxTransform(center));
-            UpdateMassAndInertia();
+            MarkDirty();
         }
     }
 }
@@ -223,7 +238,50 @@ void Urho3DPhysX::RigidBody::UpdateMassAndInertia()
     PxRigidBody* body = actor_->is<PxRigidBody>();
     if (body)
     {
-        PxRigidBodyExt::setMassAndUpdateInertia(*body, mass_, &(ToPxVec3(centerOfMass_)));
+        PxVec3 centerOfMass = ToPxVec3(centerOfMass_);
+        PxRigidBodyExt::setMassAndUpdateInertia(*body, mass_, &centerOfMass);
+        isDirty_ = false;
+    }
+}
+
+bool Urho3DPhysX::RigidBody::ComputeMassProperties(PxMassProperties & properties) const
+{
+    PxRigidBody* body = actor_ ? actor_->is<PxRigidBody>() : nullptr;
+    if (!body)
+        return false;
+    const unsigned MAX_SHAPES = 64;
+    PxShape* shapes[MAX_SHAPES];
+    unsigned numShapes = body->getShapes(shapes, MAX_SHAPES);
+    //like setMassAndUpdateInertia, only simulation shapes contribute
+    unsigned numSimShapes = 0;
+    for (unsigned i = 0; i < numShapes; ++i)
+    {
+        if (shapes[i]->getFlags() & PxShapeFlag::eSIMULATION_SHAPE)
+            shapes[numSimShapes++] = shapes[i];
+    }
+    if (!numSimShapes || numShapes < body->getNbShapes())
+        return false;
+    properties = PxRigidBodyExt::computeMassPropertiesFromShapes(shapes, numSimShapes);
+    if (properties.mass <= 0.0f)
+        return false;
+    properties = properties * (mass_ / properties.mass);
+    //inertia about center of mass set on body
+    PxVec3 centerOfMass = ToPxVec3(centerOfMass_);
+    properties.inertiaTensor = PxMassProperties::translateInertia(properties.inertiaTensor, properties.mass, properties.centerOfMass - centerOfMass);
+    properties.centerOfMass = centerOfMass;
+    return true;
+}
+
+void Urho3DPhysX::RigidBody::ApplyMassProperties(const PxMassProperties & properties)
+{
+    PxRigidBody* body = actor_->is<PxRigidBody>();
+    if (body)
+    {
+        PxQuat orientation;
+        PxVec3 inertia = PxMassProperties::getMassSpaceInertia(properties.inertiaTensor, orientation);
+        body->setMass(properties.mass);
+        body->setCMassLocalPose(PxTransform(properties.centerOfMass, orientation));
+        body->setMassSpaceInertiaTensor(inertia);
         isDirty_ = false;
     }
 }
@@ -363,7 +421,13 @@ void Urho3DPhysX::RigidBody::OnNodeSet(Node * node)
 {
     RigidActor::OnNodeSet(node);
     //update mass and inertia in case that any shape was added
-    UpdateMassAndInertia();
-    if (actor_ && actor_->getNbShapes())
-        UpdateMassAndInertia();
+    MarkDirty();
+}
+
+void Urho3DPhysX::RigidBody::OnSceneSet(Scene * scene)
+{
+    RigidActor::OnSceneSet(scene);
+    //changes made before body was added to scene
+    if (isDirty_ && pxScene_)
+        pxScene_->MarkMassDirty(this);
 }
@@ -2,6 +2,7 @@
 
 #include "RigidActor.h"
 #include <Urho3D/Scene/Node.h>
+#include <extensions/PxMassProperties.h>
 
 namespace Urho3DPhysX
 {
@@ -26,10 +27,10 @@ namespace Urho3DPhysX
         const Vector3& GetCenterOfMass() const { return centerOfMass_; }
         ///
         void SetCenterOfMass(const Vector3& center);
-        ///
+        ///Check if mass and inertia wait for recomputation
         bool IsDirty() { return isDirty_; }
-        ///
-        void MarkDirty() { isDirty_ = true; }
+        ///Request mass and inertia recomputation, done once for all changes before next simulation step
+        void MarkDirty();
         ///
         void SetLinearDamping(float dumping);
         ///
@@ -54,8 +55,12 @@ namespace Urho3DPhysX
         void SetAngularVelocity(const Vector3& value);
         ///
         Vector3 GetAngularVelocity() const;
-        ///
+        ///Recompute mass and inertia immediately
         void UpdateMassAndInertia();
+        ///Compute mass properties from simulation shapes scaled to body's mass. Only reads PhysX data, safe to call from worker threads
+        bool ComputeMassProperties(PxMassProperties& properties) const;
+        ///Set computed mass properties to PhysX body, center of mass is taken from body
+        void ApplyMassProperties(const PxMassProperties& properties);
         ///
         void ApplyForce(const Vector3& force, const Vector3& pos, TransformSpace space = TS_LOCAL);
         ///
@@ -75,9 +80,11 @@ namespace Urho3DPhysX
 
     protected:
         void OnNodeSet(Node* node) override;
+        void OnSceneSet(Scene* scene) override;
         float mass_;
         Vector3 centerOfMass_;
-        bool isDirty_;//to be removed
+        ///mass and inertia need to be recomputed
+        bool isDirty_;
         bool ccdEnabled_;
         bool kinematic_;
     };
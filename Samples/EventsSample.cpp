@@ -29,6 +29,8 @@ void EventsSample::SampleStart()
     staticShape->SetTrigger(true);
     CollisionShape* shape2 = staticBNode->CreateComponent<CollisionShape>();
     shape2->SetBox();
+    //E_COLLISION is sent for persisting contacts only when pair requested them
+    shape2->SetContactReportFlags(CR_DEFAULT | CR_TOUCH_PERSISTS);
 
     SubscribeToEvent(E_COLLISIONSTART, URHO3D_HANDLER(EventsSample, HandleCollisionStart));
     SubscribeToEvent(E_COLLISION, URHO3D_HANDLER(EventsSample, HandleCollision));
@@ -6,6 +6,8 @@
 #include <Urho3D/IO/Log.h>
 #include <Urho3D/Core/CoreEvents.h>
 #include <Urho3D/Graphics/DebugRenderer.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/UI/Text.h>
 
 using namespace Urho3DPhysX;
 static const unsigned LAYER_1 = 0x1;
@@ -54,6 +56,8 @@ void RaycastSample::SampleStart()
     trigger->SetCollisionLayer(LAYER_3);
     trigger->SetTrigger(true);
     SubscribeToEvent(trigger, E_TRIGGERENTER, URHO3D_HANDLER(RaycastSample, HandleTriggerEnter));
+    if (instructionsText_)
+        instructionsText_->SetText(instructions_ + "\nPress B to run raycast benchmark (results in log).");
 }
 
 void RaycastSample::Update(float timeStep)
@@ -158,6 +162,43 @@ void RaycastSample::Update(float timeStep)
     }
 }
 
+void RaycastSample::OnKeyUp(Key key)
+{
+    if (key == KEY_B)
+        RunQueryBenchmark();
+    else
+        SampleBase::OnKeyUp(key);
+}
+
+void RaycastSample::RunQueryBenchmark()
+{
+    if (!pxScene_)
+        return;
+    const unsigned NUM_RAYS = 10000;
+    PODVector<Ray> rays(NUM_RAYS);
+    PhysXScene::QueryBatch batch(pxScene_);
+    for (unsigned i = 0; i < NUM_RAYS; ++i)
+    {
+        Vector3 origin(Random(-15.0f, 15.0f), -5.0f, Random(-15.0f, 15.0f));
+        rays[i] = Ray(origin, Vector3(Random(-0.2f, 0.2f), 1.0f, Random(-0.2f, 0.2f)));
+        batch.AddRaycast(rays[i], 50.0f, LAYERS1_2);
+    }
+    HiresTimer timer;
+    unsigned singleHits = 0;
+    PhysXRaycastResult result;
+    for (const auto& ray : rays)
+    {
+        if (pxScene_->RaycastSingle(result, ray, 50.0f, LAYERS1_2))
+            ++singleHits;
+    }
+    long long singleTime = timer.GetUSec(true);
+    PODVector<PhysXRaycastResult> results;
+    unsigned batchHits = batch.Execute(results);
+    long long batchTime = timer.GetUSec(false);
+    URHO3D_LOGINFO(String(NUM_RAYS) + " raycasts, single calls: " + String(singleTime / 1000.0f) + " ms (" + String(singleHits) +
+        " hits), query batch: " + String(batchTime / 1000.0f) + " ms (" + String(batchHits) + " hits).");
+}
+
 void RaycastSample::HandleTriggerEnter(StringHash eventType, VariantMap & eventData)
 {
     using namespace TriggerEnter;
@@ -23,8 +23,13 @@ public:
     void SampleStart() override;
     void Update(float timeStep) override;
 
+protected:
+    void OnKeyUp(Key key) override;
+
 private:
     void HandleTriggerEnter(StringHash eventType, VariantMap& eventData);
+    ///compare single raycast calls with query batch
+    void RunQueryBenchmark();
     Urho3DPhysX::PhysXScene* pxScene_;
     Urho3D::DebugRenderer* dbr_;
     float sweepRadius_;
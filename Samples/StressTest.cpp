@@ -4,13 +4,48 @@
 #include <StaticBody.h>
 #include <GroundPlane.h>
 #include <CollisionShape.h>
+#include <Physics.h>
 #include <Urho3D/Graphics/StaticModel.h>
 #include <Urho3D/Graphics/Model.h>
 #include <Urho3D/Graphics/Material.h>
 #include <Urho3D/Graphics/Zone.h>
+#include <Urho3D/UI/UI.h>
+#include <Urho3D/UI/Text.h>
+#include <Urho3D/UI/Font.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/IO/Log.h>
 
 using namespace Urho3DPhysX;
-StressTest::StressTest(Context * context) : SampleBase(context)
+
+static const char* steppingModes[] = { "synchronous", "overlapped", "split" };
+
+#ifndef _DEBUG
+static const unsigned BENCHMARK_BOXES = 10000;
+#else
+static const unsigned BENCHMARK_BOXES = 1000;
+#endif // !_DEBUG
+static const unsigned BENCHMARK_STEPS = 300;
+
+///Clamps impulse of every contact, used to measure cost of contact modification
+class ImpulseClampModifier : public PhysXContactModifier
+{
+public:
+    void OnModifyContacts(PxContactModifyPair* pairs, unsigned count) override
+    {
+        for (unsigned i = 0; i < count; ++i)
+        {
+            PxContactSet& contacts = pairs[i].contacts;
+            for (unsigned j = 0; j < contacts.size(); ++j)
+                contacts.setMaxImpulse(j, 1000.0f);
+        }
+    }
+};
+
+static ImpulseClampModifier impulseClampModifier;
+
+StressTest::StressTest(Context * context) : SampleBase(context),
+statsText_(nullptr),
+modifyContacts_(false)
 {
 }
 
@@ -83,14 +118,148 @@ void StressTest::SampleStart()
 
                 // Give the RigidBody mass to make it movable and also adjust friction
                 boxNode->CreateComponent<DynamicBody>();
-                boxNode->CreateComponent<CollisionShape>();
+                // Identical boxes can use one pooled PxShape
+                boxNode->CreateComponent<CollisionShape>()->SetShared(true);
             }
         }
     }
-    
+    //Simulation step time, compare with application started with -pxdefaultdispatcher
+    statsText_ = GetSubsystem<UI>()->GetRoot()->CreateChild<Text>();
+    statsText_->SetFont(cache_->GetResource<Font>("Fonts/Anonymous Pro.ttf"), 15);
+    statsText_->SetPosition(10, 10);
+    if (instructionsText_)
+        instructionsText_->SetText(instructions_ + "\nPress M to switch stepping mode.\nPress C to toggle contact modification.\nPress U to measure scene unload time.\nPress B to compare step time of WorkQueue and PhysX dispatchers.");
+}
+
+void StressTest::SampleEnd()
+{
+    if (statsText_)
+    {
+        statsText_->Remove();
+        statsText_ = nullptr;
+    }
+    SampleBase::SampleEnd();
 }
 
 void StressTest::Update(float timeStep)
 {
     MoveFreeCamera(timeStep);
+    auto* pxScene = scene_->GetComponent<PhysXScene>();
+    if (statsText_ && pxScene)
+    {
+        auto* physics = GetSubsystem<Physics>();
+        statsText_->SetText(String(physics->IsUsingWorkQueueDispatcher() ? "WorkQueue dispatcher" : "PhysX dispatcher") +
+            ", " + steppingModes[pxScene->GetSteppingMode()] +
+            ", contact modification " + (modifyContacts_ ? "on" : "off") +
+            "\nStep time: " + String(pxScene->GetAverageStepTime()) + " ms, synced nodes: " + String(pxScene->GetNumSyncedNodes()) +
+            "\n" + physics->GetShapeMemoryReport() +
+            "\nCooked meshes: " + String(physics->GetNumCookedMeshes()) + ", " + String(physics->GetCookingTime()) + " ms, peak copy " +
+            String(physics->GetPeakCookingCopyMemory() / 1024) + " KB");
+    }
+}
+
+void StressTest::OnKeyUp(Key key)
+{
+    if (key == KEY_M)
+    {
+        auto* pxScene = scene_->GetComponent<PhysXScene>();
+        if (pxScene)
+            pxScene->SetSteppingMode(static_cast<PhysXSteppingMode>((pxScene->GetSteppingMode() + 1) % 3));
+    }
+    else if (key == KEY_C)
+        SetContactModification(!modifyContacts_);
+    else if (key == KEY_U)
+        RunUnloadBenchmark();
+    else if (key == KEY_B)
+        RunDispatcherBenchmark();
+    else
+        SampleBase::OnKeyUp(key);
+}
+
+void StressTest::SetContactModification(bool enable)
+{
+    auto* pxScene = scene_->GetComponent<PhysXScene>();
+    if (!pxScene)
+        return;
+    modifyContacts_ = enable;
+    pxScene->SetContactModifier(enable ? &impulseClampModifier : nullptr);
+    //opt in all shapes, compare step time with modification disabled
+    PODVector<CollisionShape*> shapes;
+    scene_->GetComponents<CollisionShape>(shapes, true);
+    for (auto* shape : shapes)
+        shape->SetContactReportFlags(enable ? CR_DEFAULT | CR_MODIFY_CONTACTS : CR_DEFAULT);
+}
+
+void StressTest::RunUnloadBenchmark()
+{
+    const unsigned actorCounts[] = { 1000, 2000, 5000, 10000 };
+    for (unsigned count : actorCounts)
+    {
+        SharedPtr<Scene> scene(new Scene(context_));
+        auto* pxScene = scene->CreateComponent<PhysXScene>();
+        for (unsigned i = 0; i < count; ++i)
+        {
+            Node* node = scene->CreateChild("Box");
+            node->SetPosition(Vector3((float)(i % 100) * 2.0f, 1.0f + (float)(i / 100) * 2.0f, 0.0f));
+            node->CreateComponent<DynamicBody>();
+            node->CreateComponent<CollisionShape>();
+        }
+        //scene is never updated, shapes are built and actors inserted here as on first step
+        pxScene->FlushDirtyShapes();
+        pxScene->FlushPendingActors();
+        //PhysX scene teardown is measured apart from destruction of nodes and components
+        HiresTimer timer;
+        scene->RemoveComponent(pxScene);
+        float releaseTime = timer.GetUSec(true) / 1000.0f;
+        scene.Reset();
+        float resetTime = timer.GetUSec(false) / 1000.0f;
+        URHO3D_LOGINFO("Scene unload, " + String(count) + " actors: PhysXScene " + String(releaseTime) + " ms, nodes " + String(resetTime) + " ms");
+    }
+}
+
+void StressTest::RunDispatcherBenchmark()
+{
+    auto* physics = GetSubsystem<Physics>();
+    WorkQueueDispatcher* workQueueDispatcher = physics->GetWorkQueueDispatcher();
+    if (!workQueueDispatcher)
+    {
+        URHO3D_LOGWARNING("Dispatcher benchmark needs WorkQueue dispatcher, start without -pxdefaultdispatcher.");
+        return;
+    }
+    //same number of threads for both
+    unsigned numThreads = workQueueDispatcher->getWorkerCount();
+    PxDefaultCpuDispatcher* defaultDispatcher = PxDefaultCpuDispatcherCreate(numThreads);
+    float workQueueTime = MeasureStepTime(workQueueDispatcher);
+    float defaultTime = MeasureStepTime(defaultDispatcher);
+    defaultDispatcher->release();
+    URHO3D_LOGINFO("Dispatcher benchmark, " + String(BENCHMARK_BOXES) + " boxes, " + String(BENCHMARK_STEPS) + " steps, " + String(numThreads) + " threads: WorkQueue " +
+        String(workQueueTime) + " ms, PhysX " + String(defaultTime) + " ms per step");
+}
+
+float StressTest::MeasureStepTime(PxCpuDispatcher* dispatcher)
+{
+    PxPhysics* px = GetSubsystem<Physics>()->GetPhysics();
+    PxSceneDesc descr(px->getTolerancesScale());
+    descr.gravity = PxVec3(0.0f, -9.81f, 0.0f);
+    descr.cpuDispatcher = dispatcher;
+    descr.filterShader = PxDefaultSimulationFilterShader;
+    PxScene* scene = px->createScene(descr);
+    PxMaterial* material = px->createMaterial(0.5f, 0.5f, 0.1f);
+    scene->addActor(*PxCreatePlane(*px, PxPlane(0.0f, 1.0f, 0.0f, 0.0f), *material));
+    //columns of boxes falling on each other, like the stress test scene
+    for (unsigned i = 0; i < BENCHMARK_BOXES; ++i)
+    {
+        PxTransform pose(PxVec3((float)(i % 20) * 1.5f, 1.0f + (float)(i / 400) * 1.5f, (float)(i / 20 % 20) * 1.5f));
+        scene->addActor(*PxCreateDynamic(*px, pose, PxBoxGeometry(0.5f, 0.5f, 0.5f), *material, 1.0f));
+    }
+    HiresTimer timer;
+    for (unsigned i = 0; i < BENCHMARK_STEPS; ++i)
+    {
+        scene->simulate(1.0f / 60.0f);
+        scene->fetchResults(true);
+    }
+    float stepTime = timer.GetUSec(false) / 1000.0f / BENCHMARK_STEPS;
+    scene->release();
+    material->release();
+    return stepTime;
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include "SampleBase.h"
+#include <PhysXDispatcher.h>
 
 class StressTest : public SampleBase
 {
@@ -10,5 +11,21 @@ public:
     ~StressTest();
 
     void SampleStart() override;
+    void SampleEnd() override;
     void Update(float timeStep) override;
+
+protected:
+    void OnKeyUp(Key key) override;
+
+private:
+    ///Toggle contact modification on all shapes
+    void SetContactModification(bool enable);
+    ///Log time of destroying scenes with increasing number of actors
+    void RunUnloadBenchmark();
+    ///Log average step time of the same box pile simulated with WorkQueue dispatcher and PhysX's own thread pool
+    void RunDispatcherBenchmark();
+    ///Simulate box pile in new PhysX scene, returns average step time in ms
+    float MeasureStepTime(PxCpuDispatcher* dispatcher);
+    Text* statsText_;
+    bool modifyContacts_;
 };
\ No newline at end of file
@@ -16,6 +16,7 @@
 #include <Urho3D/UI/UI.h>
 #include <Urho3D/UI/UIEvents.h>
 #include <Urho3D/Input/Input.h>
+#include <Urho3D/Core/ProcessUtils.h>
 
 using namespace Urho3DPhysX;
 PhysXSamples::PhysXSamples(Context * context) : Application(context),
@@ -48,6 +49,9 @@ void PhysXSamples::Start()
     context_->RegisterSubsystem<Physics>();
     Physics* physics = GetSubsystem<Physics>();
     physics->SetDefBraodPhaseType(PxBroadPhaseType::eABP);
+    //Pass -pxdefaultdispatcher to compare WorkQueue dispatcher with PhysX's own thread pool
+    if (GetArguments().Contains("-pxdefaultdispatcher"))
+        physics->SetUseWorkQueueDispatcher(false);
     physics->InitializePhysX();
     CreateSamplesMenu();
     SubscribeToEvent(E_KEYUP, URHO3D_HANDLER(PhysXSamples, HandleKeyUp));
@@ -28,4 +28,5 @@ Urho3DPhysX::StaticBody::~StaticBody()
 void Urho3DPhysX::StaticBody::RegisterObject(Context * context)
 {
     context->RegisterFactory<StaticBody>("PhysX");
+    URHO3D_COPY_BASE_ATTRIBUTES(RigidActor);
 }